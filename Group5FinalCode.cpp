@@ -4,581 +4,6029 @@
 #include <fstream>      // Include the fstream library for file input/output operations.
 #include <sstream>      // Include the sstream library for string stream manipulation.
 #include <vector>       // Include the vector library for using dynamic arrays (vectors).
+#include <string_view>  // Include the string_view library for non-owning views of airport codes.
+#include <cstdint>      // Include the cstdint library for fixed-width integer types.
+#include <algorithm>    // Include the algorithm library for heap operations, sorting and reversing.
+#include <functional>   // Include the functional library for comparison function objects.
+#include <random>       // Include the random library for seeded synthetic networks.
+#include <chrono>       // Include the chrono library for benchmark timing.
+#include <thread>       // Include the thread library for parallel loading and queries.
+#include <mutex>        // Include the mutex library for thread synchronization.
+#include <condition_variable> // Include condition_variable for waking pool workers.
+#include <atomic>       // Include the atomic library for lock-free counters.
+#include <cstring>      // Include the cstring library for memcpy/memcmp on raw snapshot bytes.
+#include <type_traits>  // Include type_traits for the snapshot section reader.
+#include <memory>       // Include the memory library for shared network versions.
+#include <tuple>        // Include the tuple library for shortcut lists.
+#ifndef _WIN32
+#include <fcntl.h>      // Include fcntl for open().
+#include <sys/mman.h>   // Include sys/mman for memory-mapping input files.
+#include <sys/stat.h>   // Include sys/stat for file sizes.
+#include <unistd.h>     // Include unistd for close().
+#include <sys/socket.h> // Include sys/socket for the query server socket.
+#include <sys/un.h>     // Include sys/un for Unix domain socket addresses.
+#include <cerrno>       // Include cerrno to retry interrupted socket reads and writes.
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h> // Include perf_event for the cache-miss counters of --bench-order.
+#include <sys/ioctl.h>        // Include sys/ioctl to start and stop the counters.
+#include <sys/syscall.h>      // Include sys/syscall for perf_event_open().
+#endif
 
 using namespace std;    // Use the standard namespace to avoid writing std:: before standard elements.
 
-const int MAX_AIRPORTS = 200;   // Define a constant for the maximum number of airports (200).
 const int INF = 1e9;            // Define a constant for infinity (1e9) to represent unreachable distances.
 
 //==================== TASK 1 ====================//
 // Create weighted directed graph from CSV input.
-struct Edge {
+// One flight leg as read from the CSV, kept until the graph is finalized.
+struct RouteLeg {
+    int origin;      // Integer representing the origin airport's index.
     int destination; // Integer representing the destination airport's index.
-    int distance;    // Integer representing the distance to the destination.
-    int cost;        // Integer representing the cost to travel to the destination.
+    int distance;    // Integer representing the distance of the leg.
+    int cost;        // Integer representing the cost of the leg.
 };
 
-struct Airport {
-    string code;        // String representing the three-letter airport code.
-    string city;        // String representing the city where the airport is located.
-    vector<Edge> edges; // Vector of Edge structs, representing connections from this airport to others.
+// Hash index from airport code to airport index.
+// Codes of up to 8 characters are packed into a 64-bit key, so a lookup is one multiply
+// and a short linear probe over a flat power-of-two table: O(1) and allocation-free.
+struct AirportCodeIndex {
+    static const int MAX_CODE_LENGTH = 8; // Longest code that fits in a packed key.
+
+    vector<uint64_t> keys;    // Packed code of each slot (0 = empty slot).
+    vector<int> indices;      // Airport index of each slot.
+    int size = 0;             // Number of codes stored.
+    int shift = 64;           // 64 - log2(capacity), used to reduce the hash to a slot.
+
+    // Function to pack a code into a 64-bit key; returns 0 for empty or over-long codes.
+    static uint64_t pack(string_view code) {
+        if (code.empty() || code.size() > MAX_CODE_LENGTH) return 0;
+        uint64_t key = 0;
+        for (char c : code) key = (key << 8) | (unsigned char)c;
+        return key;
+    }
+
+    // Function to map a packed key to its home slot (Fibonacci hashing).
+    size_t slot(uint64_t key) const { return (size_t)((key * 0x9E3779B97F4A7C15ull) >> shift); }
+
+    // Function to find the airport index of a code, or -1 if it is unknown.
+    int find(string_view code) const {
+        uint64_t key = pack(code);
+        if (key == 0 || keys.empty()) return -1;
+        size_t mask = keys.size() - 1;
+        for (size_t i = slot(key);; i = (i + 1) & mask) {
+            if (keys[i] == key) return indices[i]; // Found the code.
+            if (keys[i] == 0) return -1;           // Hit an empty slot: the code is not stored.
+        }
+    }
+
+    // Function to add a code that is not stored yet. Returns false if the code cannot be packed.
+    bool insert(string_view code, int index) {
+        uint64_t key = pack(code);
+        if (key == 0) return false;
+        if ((size + 1) * 2 > (int)keys.size()) grow(); // Keep the load factor at or below 1/2.
+        place(key, index);
+        size++;
+        return true;
+    }
+
+    // Function to store a key in the first free slot of its probe sequence.
+    void place(uint64_t key, int index) {
+        size_t mask = keys.size() - 1;
+        size_t i = slot(key);
+        while (keys[i] != 0) i = (i + 1) & mask;
+        keys[i] = key;
+        indices[i] = index;
+    }
+
+    // Function to double the table and re-insert every stored key.
+    void grow() {
+        vector<uint64_t> oldKeys = move(keys);
+        vector<int> oldIndices = move(indices);
+        size_t capacity = oldKeys.empty() ? 16 : oldKeys.size() * 2;
+        keys.assign(capacity, 0);
+        indices.assign(capacity, -1);
+        shift = 64;
+        for (size_t c = capacity; c > 1; c >>= 1) shift--;
+        for (size_t i = 0; i < oldKeys.size(); i++) {
+            if (oldKeys[i] != 0) place(oldKeys[i], oldIndices[i]);
+        }
+    }
+};
+
+// Packed table of strings: all characters in one array plus a start offset per string.
+// Avoids one heap allocation per airport and can be written to and read from a snapshot as-is.
+struct StringTable {
+    vector<char> chars;             // Characters of every string, back to back.
+    vector<uint32_t> offset{ 0 };   // size() + 1 entries; string i is [offset[i], offset[i + 1]).
+
+    int size() const { return (int)offset.size() - 1; }
+    string_view operator[](int i) const { return string_view(chars.data() + offset[i], offset[i + 1] - offset[i]); }
+    void push_back(string_view text) {
+        chars.insert(chars.end(), text.begin(), text.end());
+        offset.push_back((uint32_t)chars.size());
+    }
+    bool operator==(const StringTable& other) const { return chars == other.chars && offset == other.offset; }
 };
 
-Airport airports[MAX_AIRPORTS]; // Array of Airport structs to store airport data.
-int airportCount = 0;          // Integer to keep track of the number of airports.
+// Finalized, immutable route graph in compressed sparse row (CSR) form.
+// The outgoing edges of airport u are the entries [offset[u], offset[u + 1]) of the
+// destination, distance and cost arrays, in the same order they appeared in the CSV.
+struct RouteGraph {
+    int airportCount = 0;     // Integer to keep track of the number of airports.
+    StringTable code;         // Three-letter airport code of each airport.
+    StringTable city;         // City of each airport.
+    vector<int> offset;       // airportCount + 1 entries; start of each airport's edge range.
+    vector<int> destination;  // Destination airport index of each edge.
+    vector<int> distance;     // Distance of each edge.
+    vector<int> cost;         // Cost of each edge.
+    vector<int> inbound;      // Number of inbound edges of each airport; see countInbound().
+    AirportCodeIndex codeIndex; // Code-to-index lookup built while loading.
 
-// Store codes and their index mapping
-struct CodeIndexPair {
-    string code; // String representing the airport code.
-    int index; // Integer representing the index of the airport in the airports array.
+    int edgeCount() const { return (int)destination.size(); }          // Total number of directed edges.
+    int degree(int u) const { return offset[u + 1] - offset[u]; }       // Number of outbound edges of u.
+    // Function to count the inbound edges of every airport, once per load.
+    void countInbound() {
+        inbound.assign(airportCount, 0);
+        for (int v : destination) inbound[v]++;
+    }
+    int findAirport(string_view airportCode) const { return codeIndex.find(airportCode); } // Index of a code, or -1.
 };
-CodeIndexPair airportCodeMap[MAX_AIRPORTS]; // Array of CodeIndexPair structs to map airport codes to indices.
-int codeMapSize = 0;                       // Integer to track the number of entries in the airportCodeMap.
 
-// Function to get the index of an airport given its code.
-int getAirportIndex(const string& code) {
-    // Iterate through the existing airport code map.
-    for (int i = 0; i < codeMapSize; i++) {
-        // If the code is found in the map, return its corresponding index.
-        if (airportCodeMap[i].code == code) return airportCodeMap[i].index;
+// Collects airports and legs while reading, then packs them into a RouteGraph.
+struct RouteGraphBuilder {
+    vector<string> code;   // Airport codes in first-seen order.
+    vector<string> city;   // Airport cities, same indexing as code.
+    vector<RouteLeg> legs; // All legs in input order.
+    AirportCodeIndex codeIndex; // Code-to-index lookup, filled as airports are first seen.
+
+    // Function to get the index of an airport given its code, adding it if it is new.
+    // Returns -1 if the code is empty or longer than AirportCodeIndex::MAX_CODE_LENGTH.
+    int getAirportIndex(string_view airportCode) {
+        int index = codeIndex.find(airportCode);
+        if (index != -1) return index; // If the code is found, return its index.
+        // If the code is not found, add it with an empty city.
+        if (!codeIndex.insert(airportCode, (int)code.size())) return -1;
+        code.push_back(string(airportCode));
+        city.push_back("");
+        return (int)code.size() - 1;
     }
-    // If the code is not found, add it to the map and the airports array.
-    airportCodeMap[codeMapSize].code = code;        // Add the new code to the map.
-    airportCodeMap[codeMapSize].index = airportCount; // Add the index
-    codeMapSize++;                                  // Increment the size of the map.
-    return airportCount++;                            // Increment the total number of airports and return the new airport's index.
-}
 
-// Function to read airport data from a CSV file.
-void readCSV(const string& filename) {
-    ifstream file(filename); // Open the file specified by filename.
-    string line;             // String to store each line read from the file.
-    getline(file, line);    // Read and discard the header line of the CSV file.
-
-    // Read the file line by line.
-    while (getline(file, line)) {
-        string originCode, destCode, originCity, destCity; // Strings to store data extracted from each line.
-        int distance, cost;                                 // Integers to store distance and cost.
-        size_t pos = 0;                                   // size_t to store position of ','
-
-        // Extract origin airport code.
-        pos = line.find(',');              // Find the first comma.
-        originCode = line.substr(0, pos);  // Extract the substring before the comma.
-        line.erase(0, pos + 1);            // Erase the extracted part and the comma.
-
-        // Extract destination airport code.
-        pos = line.find(',');              // Find the next comma.
-        destCode = line.substr(0, pos);    // Extract the substring.
-        line.erase(0, pos + 1);            // Erase.
-
-        // Extract origin city (handles quoted city names).
-        pos = line.find('"', 1);              // Find the position of the second quote.
-        originCity = line.substr(1, pos - 1);  // Extract the city name.
-        line.erase(0, pos + 2);            // Erase.
-
-        // Extract destination city (handles quoted city names).
-        pos = line.find('"', 1);
-        destCity = line.substr(1, pos - 1);
-        line.erase(0, pos + 2);
-
-        // Extract distance.
-        pos = line.find(',');
-        distance = stoi(line.substr(0, pos)); // Convert the substring to an integer.
-        line.erase(0, pos + 1);
-
-        // Extract cost.
-        cost = stoi(line);                   // Convert the remaining part of the line to an integer.
-
-        // Get the indices of the origin and destination airports.
+    // Function to add one leg, recording the cities the same way the CSV reader always has:
+    // the origin city is refreshed on every leg, the destination city only if still unknown.
+    // Returns false if either airport code is invalid.
+    bool addLeg(string_view originCode, string_view destCode, string_view originCity,
+        string_view destCity, int distance, int cost) {
         int originIdx = getAirportIndex(originCode);
         int destIdx = getAirportIndex(destCode);
+        if (originIdx == -1 || destIdx == -1) return false;
+        if (city[originIdx] != originCity) city[originIdx].assign(originCity); // Copies only when the city changes.
+        if (city[destIdx].empty()) city[destIdx].assign(destCity);
+        legs.push_back({ originIdx, destIdx, distance, cost });
+        return true;
+    }
 
-        // Store origin airport data.
-        airports[originIdx].code = originCode;
-        airports[originIdx].city = originCity;
-        airports[originIdx].edges.push_back({ destIdx, distance, cost }); // Add the edge to the origin airport's edge list.
+    // Function to pack the collected legs into CSR arrays (counting sort by origin, stable).
+    RouteGraph finalize() const {
+        RouteGraph graph;
+        graph.airportCount = (int)code.size();
+        for (const string& text : code) graph.code.push_back(text);
+        for (const string& text : city) graph.city.push_back(text);
+        graph.codeIndex = codeIndex;
+        graph.offset.assign(graph.airportCount + 1, 0);
+        for (const RouteLeg& leg : legs) graph.offset[leg.origin + 1]++;  // Count edges per origin.
+        for (int i = 0; i < graph.airportCount; i++) graph.offset[i + 1] += graph.offset[i]; // Prefix sums.
 
-        // Store destination airport data if it hasn't been stored yet.
-        if (airports[destIdx].code.empty()) {
-            airports[destIdx].code = destCode;
-            airports[destIdx].city = destCity;
+        graph.destination.resize(legs.size());
+        graph.distance.resize(legs.size());
+        graph.cost.resize(legs.size());
+        vector<int> next(graph.offset.begin(), graph.offset.end() - 1); // Next free slot per origin.
+        for (const RouteLeg& leg : legs) {
+            int slot = next[leg.origin]++;
+            graph.destination[slot] = leg.destination;
+            graph.distance[slot] = leg.distance;
+            graph.cost[slot] = leg.cost;
         }
+        graph.countInbound();
+        return graph;
     }
-    file.close(); // Close the file.
-}
+};
 
-//==================== TASK 2 ====================//
-// Dijkstra's algorithm for shortest path (minimizing distance)
-void findShortestPath(const string& originCode, const string& destCode) {
-    int origin = -1, destination = -1; // Integers to store the indices of the origin and destination airports.
+RouteGraph routeGraph; // The finalized directed route graph used by every task.
 
-    // Find the indices of the origin and destination airports.
-    for (int i = 0; i < airportCount; i++) {
-        if (airports[i].code == originCode) origin = i;       //If found, set origin
-        if (airports[i].code == destCode) destination = i; //If found, set destination
+// Function to build the reverse of a route graph (every leg turned around), without names.
+RouteGraph reverseGraph(const RouteGraph& g) {
+    RouteGraph r;
+    r.airportCount = g.airportCount;
+    r.offset.assign(g.airportCount + 1, 0);
+    for (int v : g.destination) r.offset[v + 1]++;
+    for (int i = 0; i < g.airportCount; i++) r.offset[i + 1] += r.offset[i];
+    r.destination.resize(g.edgeCount());
+    r.distance.resize(g.edgeCount());
+    r.cost.resize(g.edgeCount());
+    vector<int> next(r.offset.begin(), r.offset.end() - 1);
+    for (int u = 0; u < g.airportCount; u++) {
+        for (int e = g.offset[u]; e < g.offset[u + 1]; e++) {
+            int slot = next[g.destination[e]]++;
+            r.destination[slot] = u;
+            r.distance[slot] = g.distance[e];
+            r.cost[slot] = g.cost[e];
+        }
     }
+    return r;
+}
 
-    // If either the origin or destination airport is not found, print "None".
-    if (origin == -1 || destination == -1) {
-        cout << "Shortest route from " << originCode << " to " << destCode << ": None" << endl;
-        return;
+// Reverse of a route graph in both weight orders, for the searches that work backwards from a target
+// (Pareto bounds, k shortest routes). Built once per graph and shared by every query on it.
+struct ReverseRoutes {
+    RouteGraph byDistance; // Every leg turned around; searches minimize (distance, cost).
+    RouteGraph byCost;     // The same legs with distance and cost swapped; searches minimize (cost, distance).
+
+    void build(const RouteGraph& g) {
+        byDistance = reverseGraph(g);
+        byCost = byDistance;
+        swap(byCost.distance, byCost.cost);
     }
+};
 
-    int dist[MAX_AIRPORTS], cost[MAX_AIRPORTS], prev[MAX_AIRPORTS]; // Arrays to store distances, costs, and predecessors.
-    bool visited[MAX_AIRPORTS] = { false };                      // Array to track visited airports.
+ReverseRoutes reverseRoutes; // Reverse of routeGraph.
 
-    // Initialize distances and costs to infinity, and predecessors to -1.
-    for (int i = 0; i < airportCount; i++) {
-        dist[i] = INF;  //Set the distance to INF
-        cost[i] = INF;  //Set the cost to INF
-        prev[i] = -1; //Set previous to -1
+//==================== STATE AND REGION INDEX ====================//
+// Destination sets for state and region queries, built once at load time.
+// State codes are interned as small integers; named regions come from an optional side file.
+struct RegionIndex {
+    vector<string> stateName;            // Two-letter code of each interned state.
+    vector<int> airportState;            // State id of each airport, or -1 if its city has no state.
+    vector<vector<int>> stateAirports;   // Airports of each state, in ascending index order.
+    AirportCodeIndex stateLookup;        // State code to state id.
+    vector<string> regionName;           // Name of each region, in file order.
+    vector<vector<int>> regionAirports;  // Airports of each region, in ascending index order.
+
+    // Function to index the state of every airport (the last two characters of its city).
+    void build(const RouteGraph& g) {
+        *this = RegionIndex();
+        airportState.assign(g.airportCount, -1);
+        for (int i = 0; i < g.airportCount; i++) {
+            string_view cityName = g.city[i];
+            if (cityName.length() < 2) continue;
+            string_view state = cityName.substr(cityName.length() - 2);
+            int id = stateLookup.find(state);
+            if (id == -1) {
+                id = (int)stateName.size();
+                stateLookup.insert(state, id);
+                stateName.push_back(string(state));
+                stateAirports.push_back({});
+            }
+            airportState[i] = id;
+            stateAirports[id].push_back(i);
+        }
     }
 
-    // Distance and cost from the origin to itself are 0.
-    dist[origin] = 0;
-    cost[origin] = 0;
+    // Function to find a state id from its code, or -1.
+    int findState(string_view state) const { return stateLookup.find(state); }
 
-    // Iterate through all airports to find the shortest paths.
-    for (int count = 0; count < airportCount - 1; count++) {
-        int u = -1;         // Integer to store the index of the current airport with the minimum distance.
-        int minDist = INF; // Integer to store the minimum distance found so far.
+    // Function to find a region id from its name, or -1.
+    int findRegion(const string& name) const {
+        for (int i = 0; i < (int)regionName.size(); i++) {
+            if (regionName[i] == name) return i;
+        }
+        return -1;
+    }
 
-        // Find the unvisited airport with the smallest distance.
-        for (int i = 0; i < airportCount; i++) {
-            if (!visited[i] && dist[i] < minDist) {
-                minDist = dist[i]; // Update minimum distance
-                u = i;           // Update the index
+    // Function to read named regions from a side file. Each line is "Name: member member ...",
+    // where a member is a state code or an airport code; blank lines and '#' comments are skipped.
+    // Returns false if the file cannot be opened.
+    bool loadRegions(const string& filename, const RouteGraph& g) {
+        ifstream file(filename);
+        if (!file) return false;
+        string line;
+        int lineNumber = 0;
+        while (getline(file, line)) {
+            lineNumber++;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            size_t start = line.find_first_not_of(" \t");
+            if (start == string::npos || line[start] == '#') continue;
+            size_t colon = line.find(':');
+            if (colon == string::npos) {
+                cerr << filename << ":" << lineNumber << ": expected \"Name: members\", line skipped" << endl;
+                continue;
             }
-        }
+            string name = line.substr(start, colon - start);
+            while (!name.empty() && (name.back() == ' ' || name.back() == '\t')) name.pop_back();
 
-        // If no unvisited airport is reachable, break the loop.
-        if (u == -1) break;
-        visited[u] = true; // Mark the current airport as visited.
+            vector<int> members;
+            istringstream tokens(line.substr(colon + 1));
+            string token;
+            while (tokens >> token) {
+                int state = findState(token);
+                int airport = g.findAirport(token);
+                if (state != -1) members.insert(members.end(), stateAirports[state].begin(), stateAirports[state].end());
+                else if (airport != -1) members.push_back(airport);
+                else cerr << filename << ":" << lineNumber << ": unknown state or airport " << token << endl;
+            }
+            sort(members.begin(), members.end());
+            members.erase(unique(members.begin(), members.end()), members.end());
 
-        // Update the distances and costs of the adjacent airports.
-        for (int j = 0; j < airports[u].edges.size(); j++) {
-            Edge edge = airports[u].edges[j]; // Get the edge
-            int v = edge.destination;     // Get the destination
-            // If a shorter path to v is found, update its distance, cost, and predecessor.
-            if (!visited[v] && dist[u] + edge.distance < dist[v]) {
-                dist[v] = dist[u] + edge.distance; // Update distance
-                cost[v] = cost[u] + edge.cost;     // Update cost
-                prev[v] = u;                       // Update previous
+            int id = findRegion(name);
+            if (id == -1) {
+                regionName.push_back(name);
+                regionAirports.push_back(move(members));
+            }
+            else {
+                regionAirports[id] = move(members); // A later definition replaces an earlier one.
             }
         }
+        return true;
     }
+};
 
-    // If the destination is not reachable, print "None".
-    if (dist[destination] == INF) {
-        cout << "Shortest route from " << originCode << " to " << destCode << ": None" << endl;
-        return;
+RegionIndex regionIndex; // State and region destination sets for routeGraph.
+
+//==================== CONNECTIVITY ====================//
+// Component index of the route graph, built once at load time. Strongly connected components come
+// from an iterative Tarjan search, which numbers them in reverse topological order: a leg between two
+// components always leads to a smaller id, so u can only reach v if scc[u] >= scc[v]. Weak components
+// (the connected components of G_u) come from a disjoint-set pass over the legs. Together they reject
+// most unreachable pairs in O(1); when the condensation is small enough, a reachability bitset per
+// component answers every pair exactly. The member lists of both partitions are kept for splitting
+// work by component.
+
+// Disjoint-set forest with path halving and union by size. Every operation runs in amortized
+// near-constant time; used by Kruskal's algorithm and reusable for connectivity queries.
+struct DisjointSet {
+    vector<int> parent; // Parent of each element; roots are their own parent.
+    vector<int> size;   // Number of elements under each root.
+    int sets = 0;       // Number of disjoint sets.
+
+    explicit DisjointSet(int n = 0) { reset(n); }
+
+    // Function to make n singleton sets.
+    void reset(int n) {
+        parent.resize(n);
+        for (int i = 0; i < n; i++) parent[i] = i;
+        size.assign(n, 1);
+        sets = n;
     }
 
-    // Reconstruct the shortest path.
-    vector<int> path;       // Vector to store the indices of the airports in the shortest path.
-    int at = destination; // Integer to track the current airport while backtracking.
-    while (at != -1) {
-        path.insert(path.begin(), at); // Insert the current airport at the beginning of the path.
-        at = prev[at];                 // Move to the previous airport in the path.
+    // Function to find the root of the set containing x, halving the path on the way.
+    int find(int x) {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
     }
 
-    // Print the shortest path, its length, and its cost.
-    cout << "Shortest route from " << originCode << " to " << destCode << ": ";
-    for (int i = 0; i < path.size(); i++) {
-        cout << airports[path[i]].code; // Print the airport code.
-        if (i != path.size() - 1)
-            cout << " -> ";
+    // Function to merge the sets of a and b. Returns false if they were already the same set.
+    bool unite(int a, int b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) return false;
+        if (size[a] < size[b]) swap(a, b);
+        parent[b] = a;
+        size[a] += size[b];
+        sets--;
+        return true;
     }
-    cout << ". The length is " << dist[destination] << ". The cost is $" << cost[destination] << "." << endl;
-}
 
-//==================== TASK 3 ====================//
-// Find all shortest paths from origin to all airports in a specific state (city substring)
-void usingState(const string& originCode, const string& destCity) {
-    string destState = destCity.substr(destCity.length() - 2, 2); // Extract the state abbreviation (last two characters of destCity).
-    cout << "\nShortest route from " << originCode << " to " << destState << " state airports are: " << endl;
-    cout << "\n" << left << setw(30) << "Path" << setw(10) << "Length" << setw(10) << "Cost" << endl;
-    int origin = -1;                                          // Integer to store the index of the origin airport.
-    vector<int> destination;                                 // Vector to store indices of airports in the destination state.
-    // Find the index of the origin airport and the indices of airports in the destination state.
-    for (int i = 0; i < airportCount; ++i) {
-        if (airports[i].code == originCode) origin = i;
-        if (airports[i].city.substr(airports[i].city.length() - 2, 2) == destState) destination.push_back(i);
-    }
-
-    // Iterate through each destination airport in the specified state.
-    for (int count : destination) {
-        vector<int> dist(airportCount, INF), cost(airportCount, INF), prev(airportCount, -1); // Initialize distance, cost, and predecessor arrays.
-        vector<bool> visited(airportCount, false);                                         // Initialize visited array.
-        dist[origin] = cost[origin] = 0;                                                  // Set distance and cost from origin to itself to 0.
-
-        // Dijkstra's algorithm to find the shortest path to the current destination airport.
-        for (int step = 0; step < airportCount - 1; ++step) {
-            int u = -1, minDist = INF;
-            for (int i = 0; i < airportCount; ++i)
-                if (!visited[i] && dist[i] < minDist) minDist = dist[i], u = i;
-
-            if (u == -1) break;
-            visited[u] = true;
-
-            for (const Edge& edge : airports[u].edges) {
-                int v = edge.destination;
-                if (!visited[v] && dist[u] + edge.distance < dist[v]) {
-                    dist[v] = dist[u] + edge.distance;
-                    cost[v] = cost[u] + edge.cost;
-                    prev[v] = u;
+    bool connected(int a, int b) { return find(a) == find(b); }
+};
+
+// Answer of an O(1) reachability check.
+enum class Reachability { No, Yes, Unknown };
+
+struct ConnectivityIndex {
+    int sccCount = 0;          // Number of strongly connected components.
+    int weakCount = 0;         // Number of weakly connected components.
+    vector<int> scc;           // Strong component of each airport, in reverse topological order.
+    vector<int> weak;          // Weak component of each airport, numbered in airport order.
+    vector<int> sccStart;      // sccCount + 1 entries; component c is sccMembers[sccStart[c] .. sccStart[c + 1]).
+    vector<int> sccMembers;    // Airports grouped by strong component, ascending within each.
+    vector<int> weakStart;     // weakCount + 1 entries, like sccStart.
+    vector<int> weakMembers;   // Airports grouped by weak component, ascending within each.
+    int closureWords = 0;      // 64-bit words per row of closure (0 when there is no closure).
+    vector<uint64_t> closure;  // Row c has bit d set if component c reaches component d.
+
+    int sccSize(int c) const { return sccStart[c + 1] - sccStart[c]; }
+    int weakSize(int c) const { return weakStart[c + 1] - weakStart[c]; }
+
+    // Function to index g. The closure is built when there are at most maxClosureComponents strong
+    // components (it takes sccCount^2 bits).
+    void build(const RouteGraph& g, int maxClosureComponents = 4096) {
+        int n = g.airportCount;
+        *this = ConnectivityIndex();
+        scc.assign(n, -1);
+        vector<int> order(n, -1), low(n, 0), nextLeg(n, 0), stack, call;
+        vector<char> onStack(n, 0);
+        int counter = 0;
+        for (int root = 0; root < n; root++) {
+            if (order[root] != -1) continue;
+            call.push_back(root);
+            order[root] = low[root] = counter++;
+            nextLeg[root] = g.offset[root];
+            stack.push_back(root);
+            onStack[root] = 1;
+            while (!call.empty()) {
+                int v = call.back();
+                if (nextLeg[v] < g.offset[v + 1]) {
+                    int w = g.destination[nextLeg[v]++];
+                    if (order[w] == -1) {
+                        order[w] = low[w] = counter++;
+                        nextLeg[w] = g.offset[w];
+                        stack.push_back(w);
+                        onStack[w] = 1;
+                        call.push_back(w);
+                    }
+                    else if (onStack[w]) {
+                        low[v] = min(low[v], order[w]);
+                    }
+                    continue;
                 }
+                call.pop_back();
+                if (!call.empty()) low[call.back()] = min(low[call.back()], low[v]);
+                if (low[v] != order[v]) continue;
+                int w;
+                do { // v is the root of a component: pop its members.
+                    w = stack.back();
+                    stack.pop_back();
+                    onStack[w] = 0;
+                    scc[w] = sccCount;
+                } while (w != v);
+                sccCount++;
             }
         }
-        // If the destination airport is not reachable, print "None".
-        if (dist[count] == INF) {
-            cout << "Shortest route from " << originCode << " to " << airports[count].code << ": None" << endl;
-            continue;
+
+        DisjointSet sets(n);
+        for (int u = 0; u < n; u++) {
+            for (int e = g.offset[u]; e < g.offset[u + 1]; e++) sets.unite(u, g.destination[e]);
         }
-        else {
-            // Reconstruct the shortest path.
-            vector<int> path;
-            for (int at = count; at != -1; at = prev[at])
-                path.insert(path.begin(), at);
-            string pathstr;
-            for (int i = 0; i < path.size(); i++) {
-                pathstr += airports[path[i]].code;
-                if (i != path.size() - 1)
-                    pathstr += "->";
+        weak.assign(n, -1);
+        vector<int> rootId(n, -1);
+        for (int v = 0; v < n; v++) {
+            int r = sets.find(v);
+            if (rootId[r] == -1) rootId[r] = weakCount++;
+            weak[v] = rootId[r];
+        }
+
+        // Member lists by counting sort, so airports stay ascending within each component.
+        auto group = [n](const vector<int>& id, int count, vector<int>& start, vector<int>& members) {
+            start.assign(count + 1, 0);
+            for (int v = 0; v < n; v++) start[id[v] + 1]++;
+            for (int c = 0; c < count; c++) start[c + 1] += start[c];
+            members.resize(n);
+            vector<int> fill(start.begin(), start.end() - 1);
+            for (int v = 0; v < n; v++) members[fill[id[v]]++] = v;
+        };
+        group(scc, sccCount, sccStart, sccMembers);
+        group(weak, weakCount, weakStart, weakMembers);
+
+        if (sccCount > maxClosureComponents) return;
+        // Components reached by a leg have smaller ids, so rows are complete when they are ORed in.
+        closureWords = (sccCount + 63) / 64;
+        closure.assign((size_t)sccCount * closureWords, 0);
+        vector<int> seen(sccCount, -1);
+        for (int c = 0; c < sccCount; c++) {
+            uint64_t* row = &closure[(size_t)c * closureWords];
+            row[c / 64] |= uint64_t(1) << (c % 64);
+            for (int k = sccStart[c]; k < sccStart[c + 1]; k++) {
+                int u = sccMembers[k];
+                for (int e = g.offset[u]; e < g.offset[u + 1]; e++) {
+                    int d = scc[g.destination[e]];
+                    if (d == c || seen[d] == c) continue;
+                    seen[d] = c;
+                    const uint64_t* other = &closure[(size_t)d * closureWords];
+                    for (int i = 0; i < closureWords; i++) row[i] |= other[i];
+                }
             }
-            // Print the shortest path, its length, and its cost.
-            cout << left << setw(30) << pathstr << setw(10) << dist[count] << setw(10) << cost[count] << endl;
         }
     }
 
+    // Function to check in O(1) whether there is a route from u to v. Unknown only happens
+    // without a closure, for pairs the component ids cannot decide.
+    Reachability reachable(int u, int v) const {
+        if (u == v) return Reachability::Yes;
+        if (weak[u] != weak[v]) return Reachability::No;
+        int cu = scc[u], cv = scc[v];
+        if (cu == cv) return Reachability::Yes;
+        if (cu < cv) return Reachability::No;
+        if (closureWords == 0) return Reachability::Unknown;
+        bool bit = (closure[(size_t)cu * closureWords + cv / 64] >> (cv % 64)) & 1;
+        return bit ? Reachability::Yes : Reachability::No;
+    }
+};
+
+ConnectivityIndex connectivity; // Reachability index for routeGraph.
+
+//==================== AIRPORT ORDER ====================//
+// Airports are numbered in first-seen input order, so the neighbors of an airport are scattered over
+// the per-airport arrays and most relaxations touch a new cache line. renumberAirports() permutes the
+// graph so that connected airports get nearby indices. Codes, cities and the code index move with
+// their airports, so every lookup by code gives the same answer; only listings printed in index order
+// (and the choice between equally good routes) can change.
+
+// Airport numbering applied after loading.
+enum class AirportOrder {
+    Loaded,  // First-seen input order (no renumbering).
+    BFS,     // Breadth-first over G_u, each component from its busiest airport.
+    RCM,     // Reverse Cuthill-McKee: breadth-first from the quietest airport, neighbors by degree, reversed.
+    HubFirst // By number of legs (inbound plus outbound), busiest first.
+};
+
+AirportOrder airportOrder = AirportOrder::Loaded; // Numbering applied by readCSV and readSnapshot.
+
+// Function to parse an order name ("loaded", "bfs", "rcm" or "hub"). Returns false if it is unknown.
+bool parseAirportOrder(string_view name, AirportOrder& order) {
+    if (name == "loaded") order = AirportOrder::Loaded;
+    else if (name == "bfs") order = AirportOrder::BFS;
+    else if (name == "rcm") order = AirportOrder::RCM;
+    else if (name == "hub") order = AirportOrder::HubFirst;
+    else return false;
+    return true;
 }
-//==================== TASK 4 ====================//
-// Find shortest path with exact number of stops
-void dfs(int current, int destination, int stopsLeft, int distanceSoFar,
-    int costSoFar, int& distance, int& cost, vector<bool>& visited, vector<int>& path,
-    vector<int>& bestPath) {
-    // If the number of stops left is negative, return (backtrack).
-    if (stopsLeft < 0) return;
 
-    visited[current] = true;     // Mark the current airport as visited.
-    path.push_back(current);      // Add the current airport to the current path.
+const char* AIRPORT_ORDER_NAME[] = { "loaded", "bfs", "rcm", "hub" };
 
-    // If the destination is reached and the required number of stops is met.
-    if (current == destination && stopsLeft == 0) {
-        // If the current path is shorter than the best path found so far.
-        if (distanceSoFar < distance) {
-            distance = distanceSoFar; // Update the shortest distance.
-            cost = costSoFar;         // Update the corresponding cost.
-            bestPath = path;          // Update the best path.
+// Function to compute a numbering of the airports of g: the result lists the current index of every
+// airport in its new position. Ties are broken by current index, so the order is deterministic.
+vector<int> airportOrdering(const RouteGraph& g, AirportOrder order) {
+    int n = g.airportCount;
+    vector<int> result(n);
+    for (int i = 0; i < n; i++) result[i] = i;
+    if (order == AirportOrder::Loaded) return result;
+    if (order == AirportOrder::HubFirst) {
+        stable_sort(result.begin(), result.end(), [&](int a, int b) {
+            return g.degree(a) + g.inbound[a] > g.degree(b) + g.inbound[b];
+        });
+        return result;
+    }
+
+    // Neighbors in G_u (legs in either direction), without duplicates.
+    vector<int> start(n + 1, 0), neighbors(2 * (size_t)g.edgeCount());
+    for (int u = 0; u < n; u++) {
+        for (int e = g.offset[u]; e < g.offset[u + 1]; e++) {
+            start[u + 1]++;
+            start[g.destination[e] + 1]++;
         }
     }
-    else {
-        // Explore all neighbors of the current airport.
-        for (const Edge& edge : airports[current].edges) {
-            int next = edge.destination; // Get the destination airport of the edge.
-            // If the neighbor has not been visited, recursively call dfs.
-            if (!visited[next]) {
-                dfs(next, destination, stopsLeft - 1, distanceSoFar + edge.distance, costSoFar + edge.cost, distance, cost, visited, path, bestPath);
-            }
+    for (int u = 0; u < n; u++) start[u + 1] += start[u];
+    vector<int> fill(start.begin(), start.end() - 1);
+    for (int u = 0; u < n; u++) {
+        for (int e = g.offset[u]; e < g.offset[u + 1]; e++) {
+            neighbors[fill[u]++] = g.destination[e];
+            neighbors[fill[g.destination[e]]++] = u;
         }
     }
-
-    path.pop_back();       // Remove the current airport from the path (backtrack).
-    visited[current] = false; // Mark the current airport as unvisited.
-}
-void withNoOfStops(const string& originCode, const string& destCode, int stops) {
-    int origin = -1, destination = -1; // Integers to store the indices of the origin and destination airports.
-    // Find the indices of the origin and destination airports.
-    for (int i = 0; i < airportCount; i++) {
-        if (airports[i].code == originCode) origin = i;
-        if (airports[i].code == destCode) destination = i;
+    vector<int> degree(n);
+    for (int u = 0; u < n; u++) {
+        auto first = neighbors.begin() + start[u], last = neighbors.begin() + fill[u];
+        sort(first, last);
+        degree[u] = (int)(unique(first, last) - first);
     }
 
-    // If either the origin or destination airport is not found, print "None".
-    if (origin == -1 || destination == -1) {
-        cout << "\nShortest route from " << originCode << " to " << destCode << ": None" << endl;
-        return;
+    // Roots are tried busiest first for BFS and quietest first for RCM (a low-degree airport usually
+    // sits at the edge of its component, which keeps the breadth-first levels narrow).
+    bool rcm = order == AirportOrder::RCM;
+    stable_sort(result.begin(), result.end(), [&](int a, int b) { return rcm ? degree[a] < degree[b] : degree[a] > degree[b]; });
+    vector<int> roots = move(result);
+    result.clear();
+    result.reserve(n);
+    vector<char> placed(n, 0);
+    for (int root : roots) {
+        if (placed[root]) continue;
+        size_t head = result.size();
+        result.push_back(root);
+        placed[root] = 1;
+        while (head < result.size()) {
+            int u = result[head++];
+            size_t level = result.size();
+            for (int k = start[u]; k < start[u] + degree[u]; k++) {
+                int v = neighbors[k];
+                if (placed[v]) continue;
+                placed[v] = 1;
+                result.push_back(v);
+            }
+            if (rcm) {
+                stable_sort(result.begin() + level, result.end(), [&](int a, int b) { return degree[a] < degree[b]; });
+            }
+        }
     }
+    if (rcm) reverse(result.begin(), result.end());
+    return result;
+}
 
-    vector<bool> visited(airportCount, false); // Array to track visited airports.
-    vector<int> bestPath, path;                // Vectors to store the best path and current path.
-    int distance = INF, cost = INF;            // Initialize distance and cost to infinity.
-
-    // Call the dfs function to find the shortest path with the specified number of stops.
-    dfs(origin, destination, stops + 1, 0, 0, distance, cost, visited, path, bestPath);
-
-    // If no path with the specified number of stops is found, print "None".
-    if (distance == INF)
-        cout << "\nShortest route from " << originCode << " to " << destCode << " with " << stops << " stops: None";
-    else {
-        // Print the shortest path, its length, and its cost.
-        cout << "\nShortest route from " << originCode << " to " << destCode << " with " << stops << " stops: ";
-        for (int i = 0; i < bestPath.size(); i++) {
-            cout << airports[bestPath[i]].code;
-            if (i != bestPath.size() - 1)
-                cout << "->";
+// Function to renumber the airports of g: airport order[i] becomes airport i. Every airport keeps its
+// legs in their input order, and the code index is rebuilt for the new indices.
+RouteGraph renumberAirports(const RouteGraph& g, const vector<int>& order) {
+    int n = g.airportCount;
+    vector<int> position(n);
+    for (int i = 0; i < n; i++) position[order[i]] = i;
+    RouteGraph result;
+    result.airportCount = n;
+    result.offset.assign(n + 1, 0);
+    result.inbound.resize(n);
+    for (int i = 0; i < n; i++) {
+        int old = order[i];
+        result.code.push_back(g.code[old]);
+        result.city.push_back(g.city[old]);
+        result.codeIndex.insert(g.code[old], i);
+        result.offset[i + 1] = result.offset[i] + g.degree(old);
+        result.inbound[i] = g.inbound[old];
+    }
+    result.destination.resize(g.edgeCount());
+    result.distance.resize(g.edgeCount());
+    result.cost.resize(g.edgeCount());
+    for (int i = 0; i < n; i++) {
+        int slot = result.offset[i];
+        for (int e = g.offset[order[i]]; e < g.offset[order[i] + 1]; e++, slot++) {
+            result.destination[slot] = position[g.destination[e]];
+            result.distance[slot] = g.distance[e];
+            result.cost[slot] = g.cost[e];
         }
-        cout << ". The length is " << distance << ". The cost is $" << cost << "." << endl;
     }
+    return result;
 }
 
-//==================== TASK 5 ====================//
-// Count and display direct connections (inbound + outbound), sort manually
-struct AirportConnection {
-    string code;       // String to store the airport code.
-    int outbound = 0;  // Integer to store the number of outbound connections.
-    int inbound = 0;   // Integer to store the number of inbound connections.
-    int total;       // Integer to store the total number of connections.
-};
-
-void FlightConnections() {
-    AirportConnection connections[MAX_AIRPORTS]; // Array to store connection information for each airport.
-    //Initialize connections
-    for (int i = 0; i < airportCount; i++) {
-        connections[i].outbound = airports[i].edges.size(); // Outbound connections = number of edges.
-        connections[i].inbound = 0;                         // Initialize inbound to 0.
-        connections[i].code = airports[i].code;           // Store the airport code.
-        connections[i].total = 0;                          // Initialize total to 0.
+//==================== THREAD POOL ====================//
+// Fixed set of worker threads that run batches of independent tasks.
+class ThreadPool {
+public:
+    // Function to start the given number of workers (at least one).
+    explicit ThreadPool(int threads) {
+        for (int i = 0; i < max(1, threads); i++) workers.emplace_back([this, i] { workerLoop(i); });
     }
-    //Counts inbound connection
-    for (int i = 0; i < airportCount; i++) {
-        for (int j = 0; j < airports[i].edges.size(); j++) {
-            int destinationIdx = airports[i].edges[j].destination; // Get destination
-            connections[destinationIdx].inbound++;                 // Increment inbound for destination.
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
         }
-    }
-    //Adds connection
-    for (int i = 0; i < airportCount; i++) {
-        connections[i].total = connections[i].inbound + connections[i].outbound; //Calculate total connections.
+        wake.notify_all();
+        for (thread& worker : workers) worker.join();
     }
 
-    // Count and display direct connections (inbound + outbound), sort manually
+    int size() const { return (int)workers.size(); }
 
-    //Outer loop for sorting
-    //Inner loop for comparing and swapping
-    for (int i = 0; i < airportCount - 1; i++) {
-        for (int j = i + 1; j < airportCount; j++) {
-            if (connections[j].total > connections[i].total) {
-                AirportConnection temp = connections[i];
-                connections[i] = connections[j];
-                connections[j] = temp;
-            }
+    // Function to run task(index, worker) for every index in [0, count) and wait for all of them.
+    // Workers take indices in order from a shared counter. Not reentrant.
+    void run(int count, const function<void(int, int)>& task) {
+        if (count <= 0) return;
+        unique_lock<mutex> guard(lock);
+        job = &task;
+        jobCount = count;
+        nextTask = 0;
+        busy = (int)workers.size();
+        generation++;
+        wake.notify_all();
+        done.wait(guard, [this] { return busy == 0; });
+        job = nullptr;
+    }
+
+    // Function to run task(index, worker) for every index in [0, count) with work stealing: each
+    // worker starts on its own contiguous block of indices and, once that is empty, steals the upper
+    // half of the largest remaining block. Suited to tasks of very uneven cost. Not reentrant.
+    void runStealing(int count, const function<void(int, int)>& task) {
+        if (count <= 0) return;
+        int blocks = size();
+        // Block b is packed as (end << 32) | begin so owner and thieves update it with one CAS.
+        vector<atomic<uint64_t>> range(blocks);
+        for (int b = 0; b < blocks; b++) {
+            uint64_t begin = (uint64_t)count * b / blocks, end = (uint64_t)count * (b + 1) / blocks;
+            range[b] = (end << 32) | begin;
         }
+        run(blocks, [&](int own, int worker) {
+            while (true) {
+                // Take the next index from the front of our block.
+                uint64_t r = range[own].load();
+                uint32_t begin = (uint32_t)r, end = (uint32_t)(r >> 32);
+                if (begin < end) {
+                    if (range[own].compare_exchange_weak(r, ((uint64_t)end << 32) | (begin + 1))) task((int)begin, worker);
+                    continue;
+                }
+                // Own block is empty: steal the upper half of the largest remaining block.
+                int largest = -1;
+                uint32_t largestSize = 0;
+                for (int b = 0; b < blocks; b++) {
+                    uint64_t rb = range[b].load();
+                    uint32_t sizeB = (uint32_t)(rb >> 32) - (uint32_t)rb;
+                    if ((uint32_t)(rb >> 32) > (uint32_t)rb && sizeB > largestSize) {
+                        largestSize = sizeB;
+                        largest = b;
+                    }
+                }
+                if (largest == -1) return; // Nothing left anywhere.
+                uint64_t rv = range[largest].load();
+                uint32_t vBegin = (uint32_t)rv, vEnd = (uint32_t)(rv >> 32);
+                if (vBegin >= vEnd) continue;
+                uint32_t split = vBegin + (vEnd - vBegin) / 2; // Victim keeps [vBegin, split).
+                if (!range[largest].compare_exchange_strong(rv, ((uint64_t)split << 32) | vBegin)) continue;
+                range[own] = ((uint64_t)vEnd << 32) | split;   // Stolen indices become our block.
+            }
+        });
     }
 
-    cout << "Airport     Connections\n";
-    for (int i = 0; i < airportCount; i++) {
-        cout << "  " << connections[i].code << "            " << connections[i].total << endl;
+private:
+    void workerLoop(int worker) {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                unique_lock<mutex> guard(lock);
+                wake.wait(guard, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            for (int t = nextTask++; t < jobCount; t = nextTask++) (*job)(t, worker);
+            lock_guard<mutex> guard(lock);
+            if (--busy == 0) done.notify_all();
+        }
     }
-}
 
-//==================== TASK 6 ====================//
-// Create undirected graph from G following edge rules
-struct UndirectedGraph {
-    string code;        // Airport code
-    string city;        // City name
-    vector<Edge> edges; // Vector of edges
+    vector<thread> workers;
+    mutex lock;
+    condition_variable wake, done;
+    const function<void(int, int)>* job = nullptr; // Current batch.
+    int jobCount = 0;                              // Number of tasks in the current batch.
+    atomic<int> nextTask{ 0 };                     // Next task index to hand out.
+    int busy = 0;                                  // Workers still running the current batch.
+    uint64_t generation = 0;                       // Incremented for every batch.
+    bool stopping = false;
 };
 
-UndirectedGraph undirectedGraph[MAX_AIRPORTS]; // Array to store the undirected graph.
+//==================== CSV LOADER ====================//
+// Zero-copy CSV loading: the file is memory-mapped and parsed in place into string views.
 
-// Function to check if there is an edge from 'from' to 'to'.
-bool hasEdge(int from, int to) {
-    for (int i = 0; i < airports[from].edges.size(); i++) {
-        if (airports[from].edges[i].destination == to) {
-            return true; // Return true if edge exists
-        }
-    }
-    return false; // Otherwise return false
-}
+// Read-only view of a whole file. Uses mmap where available and reads into a buffer otherwise.
+struct MappedFile {
+    const char* data = nullptr; // First byte of the file contents.
+    size_t size = 0;            // Number of bytes.
+#ifdef _WIN32
+    vector<char> buffer;        // File contents (no mmap on this platform).
+#endif
 
-// Function to get the cost of the edge from 'from' to 'to'.
-int getCost(int from, int to) {
-    for (int i = 0; i < airports[from].edges.size(); i++) {
-        if (airports[from].edges[i].destination == to) {
-            return airports[from].edges[i].cost; // Return the cost of the edge
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    // Function to map a file; returns false if it cannot be opened.
+    bool open(const string& filename) {
+        close();
+#ifdef _WIN32
+        ifstream file(filename, ios::binary);
+        if (!file) return false;
+        buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        data = buffer.data();
+        size = buffer.size();
+        return true;
+#else
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            return false;
+        }
+        size = (size_t)info.st_size;
+        if (size > 0) {
+            void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                size = 0;
+                return false;
+            }
+            madvise(mapped, size, MADV_SEQUENTIAL);
+            data = (const char*)mapped;
         }
+        ::close(fd); // The mapping stays valid after the descriptor is closed.
+        return true;
+#endif
     }
-    return INF; // Return INF if edge does not exist
-}
 
-// Function to build the undirected graph.
-void buildUndirectedGraph() {
-    for (int i = 0; i < airportCount; i++) {
-        undirectedGraph[i].code = airports[i].code; // Copy airport code
-        undirectedGraph[i].city = airports[i].city; // Copy city name
+    void close() {
+#ifdef _WIN32
+        buffer.clear();
+#else
+        if (data != nullptr) munmap((void*)data, size);
+#endif
+        data = nullptr;
+        size = 0;
     }
+};
 
-    // To avoid duplicating edges
-    bool added[MAX_AIRPORTS][MAX_AIRPORTS] = { false };
+// One parsed CSV record. Fields point into the mapped file, except quoted fields with doubled
+// quotes (""), which are unescaped into the row's own buffers.
+struct CsvRow {
+    static const int MAX_FIELDS = 16; // Fields beyond this are counted but not stored.
+    string_view field[MAX_FIELDS];    // Field contents without surrounding quotes.
+    string unescaped[MAX_FIELDS];     // Storage for fields that needed unescaping.
+    int count = 0;                    // Number of fields in the record.
+};
 
-    for (int u = 0; u < airportCount; u++) {
-        for (int i = 0; i < airports[u].edges.size(); i++) {
-            int v = airports[u].edges[i].destination;
-            if (!added[u][v] && !added[v][u]) {
-                bool uTOv = hasEdge(u, v); // Check if edge u to v exists
-                bool vTOu = hasEdge(v, u); // Check if edge v to u exists
-                int cost = INF;
-
-                // Apply edge rules
-                if (uTOv && vTOu) {
-                    cost = min(getCost(u, v), getCost(v, u)); // Cost is min of both directions
+// Function to parse a non-negative or negative decimal integer that fills the whole field
+// (surrounding spaces allowed). Returns false instead of throwing on malformed or out-of-range input.
+bool parseInt(string_view text, int& value) {
+    size_t i = 0, n = text.size();
+    while (i < n && text[i] == ' ') i++;
+    while (n > i && text[n - 1] == ' ') n--;
+    bool negative = i < n && text[i] == '-';
+    if (i < n && (text[i] == '-' || text[i] == '+')) i++;
+    if (i == n) return false;
+    long long result = 0;
+    for (; i < n; i++) {
+        if (text[i] < '0' || text[i] > '9') return false;
+        result = result * 10 + (text[i] - '0');
+        if (result > 2147483647LL) return false;
+    }
+    value = (int)(negative ? -result : result);
+    return true;
+}
+
+// Function to parse CSV records from [begin, end) in a single pass, calling onRow(row, lineNumber)
+// for each record. firstLine is the line number of begin. Quoted fields may contain commas,
+// doubled quotes and line breaks. Both \n and \r\n line endings are accepted. Errors are reported
+// to errors with their line number and the offending record is skipped.
+template <class RowHandler>
+void parseCsvRange(const char* begin, const char* end, int firstLine, const string& filename, ostream& errors,
+    RowHandler&& onRow) {
+    CsvRow row;
+    const char* p = begin;
+    int line = firstLine;
+    while (p < end) {
+        int rowLine = line; // Line on which this record starts.
+        row.count = 0;
+        bool malformed = false;
+        while (true) {
+            string_view value;
+            if (p < end && *p == '"') {
+                // Quoted field: runs to the next quote that is not doubled.
+                const char* start = ++p;
+                bool doubled = false;
+                while (p < end && !(*p == '"' && (p + 1 >= end || p[1] != '"'))) {
+                    if (*p == '"') {
+                        doubled = true;
+                        p++;
+                    }
+                    else if (*p == '\n') {
+                        line++;
+                    }
+                    p++;
                 }
-                else if (uTOv) {
-                    cost = getCost(u, v); // Cost is cost from u to v
+                if (p >= end) {
+                    errors << filename << ":" << rowLine << ": unterminated quoted field" << endl;
+                    return;
                 }
-                else if (vTOu) {
-                    cost = getCost(v, u); // Cost is cost from v to u
+                value = string_view(start, p - start);
+                p++; // Skip the closing quote.
+                if (doubled && row.count < CsvRow::MAX_FIELDS) {
+                    string& out = row.unescaped[row.count];
+                    out.clear();
+                    for (size_t i = 0; i < value.size(); i++) {
+                        out += value[i];
+                        if (value[i] == '"') i++; // Keep one quote of each doubled pair.
+                    }
+                    value = out;
                 }
+                // Only spaces may follow the closing quote.
+                while (p < end && *p == ' ') p++;
+                if (p < end && *p != ',' && *p != '\n' && *p != '\r') malformed = true;
+            }
+            else {
+                const char* start = p;
+                while (p < end && *p != ',' && *p != '\n' && *p != '\r') p++;
+                value = string_view(start, p - start);
+            }
+            if (row.count < CsvRow::MAX_FIELDS) row.field[row.count] = value;
+            row.count++;
 
-                // Add undirected edge if valid
-                if (cost != INF) {
-                    undirectedGraph[u].edges.push_back({ v, cost, cost }); // Using 'distance' field to store 'cost'
-                    undirectedGraph[v].edges.push_back({ u, cost, cost });
-                    added[u][v] = added[v][u] = true;
-                }
+            // Skip to the end of the field if it was malformed, then handle the delimiter.
+            while (p < end && *p != ',' && *p != '\n' && *p != '\r') p++;
+            if (p < end && *p == ',') {
+                p++;
+                continue;
             }
+            if (p < end && *p == '\r') p++;
+            if (p < end && *p == '\n') p++;
+            line++;
+            break;
+        }
+        if (malformed) {
+            errors << filename << ":" << rowLine << ": unexpected text after a quoted field, row skipped" << endl;
+            continue;
         }
+        if (row.count == 1 && row.field[0].empty()) continue; // Blank line.
+        onRow(row, rowLine);
     }
 }
 
-//Print test
-void GuGraph() {
-    cout << "Graph G_u:\n";
-    for (int i = 0; i < airportCount; i++) {
-        cout << undirectedGraph[i].code << " -> ";
-        for (int j = 0; j < undirectedGraph[i].edges.size(); j++) {
-            int destIdx = undirectedGraph[i].edges[j].destination;
-            int cost = undirectedGraph[i].edges[j].cost;
-            cout << "(" << undirectedGraph[destIdx].code << ",$" << cost << ")";
-            if (j < undirectedGraph[i].edges.size() - 1)
-                cout << ",";
-        }
-        cout << "\n" << endl;
+// Function to turn one CSV record into a leg. Returns false (after reporting why) if it is malformed.
+bool addCsvRow(RouteGraphBuilder& builder, const CsvRow& row, int lineNumber, const string& filename, ostream& errors) {
+    if (row.count < 6) {
+        errors << filename << ":" << lineNumber << ": expected 6 fields, found " << row.count << ", row skipped" << endl;
+        return false;
+    }
+    int distance, cost;
+    if (!parseInt(row.field[4], distance) || !parseInt(row.field[5], cost)) {
+        errors << filename << ":" << lineNumber << ": invalid distance or cost, row skipped" << endl;
+        return false;
     }
+    if (distance < 0 || cost < 0) { // Every search assumes non-negative weights.
+        errors << filename << ":" << lineNumber << ": negative distance or cost, row skipped" << endl;
+        return false;
+    }
+    if (!builder.addLeg(row.field[0], row.field[1], row.field[2], row.field[3], distance, cost)) {
+        errors << filename << ":" << lineNumber << ": invalid airport code, row skipped" << endl;
+        return false;
+    }
+    return true;
 }
 
-//==================== TASK 7 ====================//
-// Prim's MST on G_u
-void primMST() {
-    bool inMST[MAX_AIRPORTS] = { false }; // Array to track airports included in the MST.
-    int key[MAX_AIRPORTS], parent[MAX_AIRPORTS];  // Arrays to store the minimum edge weights and parent nodes.
+// Function to load a route CSV sequentially into graph. The first record is the header and is skipped.
+bool loadRouteGraph(const MappedFile& file, const string& filename, RouteGraph& graph) {
+    RouteGraphBuilder builder; // Builder that collects the airports and legs.
+    bool header = true;
+    parseCsvRange(file.data, file.data + file.size, 1, filename, cerr, [&](const CsvRow& row, int lineNumber) {
+        if (header) {
+            header = false;
+            return;
+        }
+        addCsvRow(builder, row, lineNumber, filename, cerr);
+    });
+    graph = builder.finalize(); // Build the immutable CSR graph once all legs are known.
+    return true;
+}
 
-    // Initialize key values to infinity and parents to -1.
-    for (int i = 0; i < airportCount; i++) {
-        key[i] = INF;
-        parent[i] = -1;
-    }
+// Function to load a route CSV on a thread pool. The file is split at line boundaries into chunks,
+// each chunk is parsed into its own builder, and the builders are merged in file order. Airports are
+// numbered in first-seen order and cities follow the sequential rules, so the graph is identical
+// to the sequential load. Error messages are also printed in file order.
+bool loadRouteGraphParallel(const MappedFile& file, const string& filename, ThreadPool& pool, RouteGraph& graph) {
+    const char* data = file.data;
+    size_t size = file.size;
+    int chunkCount = (int)min<size_t>(pool.size() * 4, max<size_t>(1, size / (1 << 20))); // At least 1 MB per chunk.
 
-    key[0] = 0; // Start with the first airport.
+    // Pass 1: count quotes and line breaks in equal byte ranges, so every split point knows
+    // whether it lies inside a quoted field and which line it is on.
+    vector<size_t> rawStart(chunkCount + 1);
+    for (int c = 0; c <= chunkCount; c++) rawStart[c] = size * c / chunkCount;
+    vector<int> quotes(chunkCount), newlines(chunkCount);
+    pool.run(chunkCount, [&](int c, int) {
+        int q = 0, nl = 0;
+        for (size_t i = rawStart[c]; i < rawStart[c + 1]; i++) {
+            q += data[i] == '"';
+            nl += data[i] == '\n';
+        }
+        quotes[c] = q;
+        newlines[c] = nl;
+    });
 
-    // Iterate until all airports are included in the MST.
-    for (int count = 0; count < airportCount - 1; count++) {
-        int u = -1;         // Integer to store the index of the airport with the minimum key value.
-        int minKey = INF; // Integer to store the minimum key value.
-        // Find the airport with the minimum key value among the unvisited airports.
-        for (int v = 0; v < airportCount; v++) {
-            if (!inMST[v] && key[v] < minKey) {
-                minKey = key[v];
-                u = v;
+    // Move each split point forward to the first line break outside quotes.
+    vector<size_t> start(chunkCount + 1);
+    vector<int> firstLine(chunkCount + 1);
+    start[0] = 0;
+    firstLine[0] = 1;
+    int quoteParity = 0, line = 1;
+    for (int c = 1; c <= chunkCount; c++) {
+        quoteParity = (quoteParity + quotes[c - 1]) & 1;
+        line += newlines[c - 1];
+        size_t i = rawStart[c];
+        int parity = quoteParity, l = line;
+        if (c < chunkCount) {
+            while (i < size && !(data[i] == '\n' && parity == 0)) {
+                parity ^= data[i] == '"';
+                i++;
+            }
+            if (i < size) {
+                i++; // Start after the line break.
+                l++;
             }
         }
+        start[c] = max(i, start[c - 1]);
+        firstLine[c] = start[c] == i ? l : firstLine[c - 1];
+    }
 
-        if (u == -1) break; // If no such airport is found, break.
-        inMST[u] = true;     // Include the selected airport in the MST.
+    // Pass 2: parse every chunk into its own builder.
+    vector<RouteGraphBuilder> parts(chunkCount);
+    vector<ostringstream> errors(chunkCount);
+    pool.run(chunkCount, [&](int c, int) {
+        bool header = c == 0;
+        parseCsvRange(data + start[c], data + start[c + 1], firstLine[c], filename, errors[c],
+            [&](const CsvRow& row, int lineNumber) {
+                if (header) {
+                    header = false;
+                    return;
+                }
+                addCsvRow(parts[c], row, lineNumber, filename, errors[c]);
+            });
+    });
+    for (int c = 0; c < chunkCount; c++) cerr << errors[c].str();
 
-        // Update the key values and parent nodes of the adjacent airports.
-        for (int j = 0; j < undirectedGraph[u].edges.size(); j++) {
-            int v = undirectedGraph[u].edges[j].destination;
-            int weight = undirectedGraph[u].edges[j].cost;
-            if (!inMST[v] && weight < key[v]) {
-                key[v] = weight;
-                parent[v] = u;
-            }
+    // Merge: number airports in chunk order, applying each chunk's city outcome in turn.
+    RouteGraphBuilder merged;
+    vector<vector<int>> remap(chunkCount);
+    vector<size_t> legStart(chunkCount + 1, 0);
+    for (int c = 0; c < chunkCount; c++) {
+        const RouteGraphBuilder& part = parts[c];
+        vector<char> wasOrigin(part.code.size(), 0);
+        for (const RouteLeg& leg : part.legs) wasOrigin[leg.origin] = 1;
+        remap[c].resize(part.code.size());
+        for (size_t i = 0; i < part.code.size(); i++) {
+            int g = merged.getAirportIndex(part.code[i]);
+            remap[c][i] = g;
+            // An origin occurrence overwrites the city; destinations only fill an empty one.
+            if (wasOrigin[i] || merged.city[g].empty()) merged.city[g] = part.city[i];
         }
+        legStart[c + 1] = legStart[c] + part.legs.size();
     }
-
-    // Print the edges of the MST and calculate the total cost.
-    cout << "\nPrim's MST Edges:\n";
-    int totalCost = 0;
-    for (int i = 1; i < airportCount; i++) {
-        if (parent[i] != -1) {
-            cout << undirectedGraph[parent[i]].code << " - " << undirectedGraph[i].code << " ($" << key[i] << ")\n";
-            totalCost += key[i];
+    merged.legs.resize(legStart[chunkCount]);
+    pool.run(chunkCount, [&](int c, int) {
+        RouteLeg* out = merged.legs.data() + legStart[c];
+        for (const RouteLeg& leg : parts[c].legs) {
+            *out++ = { remap[c][leg.origin], remap[c][leg.destination], leg.distance, leg.cost };
         }
+    });
+    graph = merged.finalize();
+    return true;
+}
+
+const size_t PARALLEL_LOAD_BYTES = 16 << 20; // CSV files at least this large load in parallel by default.
+int loaderThreads = 0; // Threads used to load route CSVs (--threads); 1 loads sequentially, 0 uses every
+                       // hardware thread for files of PARALLEL_LOAD_BYTES or more.
+
+// Function to load a route CSV into graph with loaderThreads threads.
+bool loadRouteFile(const MappedFile& file, const string& filename, RouteGraph& graph) {
+    int threads = loaderThreads;
+    if (threads == 0) threads = file.size >= PARALLEL_LOAD_BYTES ? (int)max(1u, thread::hardware_concurrency()) : 1;
+    if (threads <= 1) return loadRouteGraph(file, filename, graph);
+    ThreadPool pool(threads);
+    return loadRouteGraphParallel(file, filename, pool, graph);
+}
+
+// Function to read airport data from a CSV file and build the route graph.
+void readCSV(const string& filename) {
+    MappedFile file; // Memory-mapped CSV file.
+    if (!file.open(filename)) {
+        cerr << "Cannot open " << filename << endl;
+        return;
     }
-    cout << "Total MST cost: $" << totalCost << "\n";
+    loadRouteFile(file, filename, routeGraph);
+    if (airportOrder != AirportOrder::Loaded) routeGraph = renumberAirports(routeGraph, airportOrdering(routeGraph, airportOrder));
+    regionIndex.build(routeGraph);   // Index the airports of every state.
+    connectivity.build(routeGraph);  // Components for O(1) unreachable checks.
+    reverseRoutes.build(routeGraph); // Reverse legs for searches towards a target.
 }
 
-//==================== TASK 8 ====================//
-// Kruskal's MST (with manual disjoint set)
-struct KruskalEdge {
-    int u, v, cost; // Struct to represent an edge with its endpoints and cost.
-};
-KruskalEdge edges[MAX_AIRPORTS * MAX_AIRPORTS]; // Array to store all edges.
-int edgeCount = 0;                             // Integer to store the number of edges.
-int parentSet[MAX_AIRPORTS];                   // Array for the disjoint set data structure.
-// Function to find the set an element belongs to.
-int findSet(int i) {
-    while (i != parentSet[i]) i = parentSet[i]; // Path compression
-    return i;
-}
-// Function to merge two sets.
-void unionSet(int u, int v) {
-    int setU = findSet(u);
-    int setV = findSet(v);
-    if (setU != setV) parentSet[setU] = setV; // Merge the sets if they are different.
-}
-// Function to implement Kruskal's algorithm.
-void kruskalMST() {
-    edgeCount = 0;
-    // Collect all edges from the undirected graph.
-    for (int u = 0; u < airportCount; u++) {
-        for (int j = 0; j < undirectedGraph[u].edges.size(); j++) {
-            int v = undirectedGraph[u].edges[j].destination;
-            if (u < v) { // Avoid duplicate edges
-                edges[edgeCount++] = { u, v, undirectedGraph[u].edges[j].cost };
-            }
-        }
+// Function to append one CSV field, quoted (with doubled quotes) when it holds a comma or quote.
+void appendCsvField(string& line, string_view field) {
+    if (field.find_first_of(",\"") == string_view::npos) {
+        line += field;
+        return;
+    }
+    line += '"';
+    for (char c : field) {
+        if (c == '"') line += '"';
+        line += c;
     }
+    line += '"';
+}
 
-    // Manual sort (selection sort)
-    for (int i = 0; i < edgeCount - 1; i++) {
-        for (int j = i + 1; j < edgeCount; j++) {
-            if (edges[i].cost > edges[j].cost) {
-                KruskalEdge temp = edges[i];
-                edges[i] = edges[j];
-                edges[j] = temp;
-            }
+// Function to write a route graph as a CSV in the schema readCSV reads, one row per leg in CSR
+// order. Airports without legs cannot be represented and are dropped. Returns false on a write error.
+bool writeRouteCSV(const RouteGraph& g, const string& filename) {
+    ofstream file(filename, ios::binary);
+    if (!file) return false;
+    file << "Origin_airport,Destination_airport,Origin_city,Destination_city,Distance,Cost\n";
+    string line;
+    for (int u = 0; u < g.airportCount; u++) {
+        for (int e = g.offset[u]; e < g.offset[u + 1]; e++) {
+            int v = g.destination[e];
+            line.clear();
+            appendCsvField(line, g.code[u]);
+            line += ',';
+            appendCsvField(line, g.code[v]);
+            line += ',';
+            appendCsvField(line, g.city[u]);
+            line += ',';
+            appendCsvField(line, g.city[v]);
+            line += ',';
+            line += to_string(g.distance[e]);
+            line += ',';
+            line += to_string(g.cost[e]);
+            line += '\n';
+            file << line;
         }
     }
+    return (bool)file;
+}
+
+//==================== BINARY SNAPSHOT ====================//
+// Versioned binary image of a finalized route graph, for startup without parsing the CSV.
+// Layout (native byte order): SnapshotHeader, then these sections, each padded to 8 bytes:
+//   offset[V + 1], destination[E], distance[E], cost[E]                 (int32)
+//   code offsets[V + 1], city offsets[V + 1]                            (uint32)
+//   code characters, city characters                                    (char)
+//   code index keys[C] (uint64), code index slots[C] (int32)
+// The checksum covers every byte after the header.
+const char SNAPSHOT_MAGIC[8] = { 'G', '5', 'R', 'O', 'U', 'T', 'E', 'S' };
+const uint32_t SNAPSHOT_VERSION = 1;
+const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304; // Reads back differently on a machine of the other endianness.
 
-    // Initialize the disjoint set.
-    for (int i = 0; i < airportCount; i++) parentSet[i] = i;
+struct SnapshotHeader {
+    char magic[8];           // SNAPSHOT_MAGIC.
+    uint32_t version;        // SNAPSHOT_VERSION.
+    uint32_t byteOrder;      // SNAPSHOT_BYTE_ORDER as written.
+    uint64_t headerSize;     // sizeof(SnapshotHeader) when written.
+    uint64_t airportCount;   // V.
+    uint64_t edgeCount;      // E.
+    uint64_t codeChars;      // Length of the code character section.
+    uint64_t cityChars;      // Length of the city character section.
+    uint64_t indexCapacity;  // C, number of code index slots.
+    int64_t indexShift;      // AirportCodeIndex::shift.
+    uint64_t checksum;       // SnapshotChecksum of the sections.
+};
 
-    // Build the MST.
-    cout << "\nKruskal's MST Edges:\n";
-    int totalCost = 0, count = 0;
-    for (int i = 0; i < edgeCount && count < airportCount - 1; i++) {
-        int u = edges[i].u;
-        int v = edges[i].v;
-        // If the endpoints of the edge belong to different sets, include the edge in the MST.
-        if (findSet(u) != findSet(v)) {
-            unionSet(u, v); // Merge the sets.
-            cout << undirectedGraph[u].code << " - " << undirectedGraph[v].code << " ($" << edges[i].cost << ")\n";
-            totalCost += edges[i].cost; // Add the cost to the total.
-            count++;                   // Increment the edge count.
+// FNV-1a style hash over 64-bit words; every section is a whole number of words.
+struct SnapshotChecksum {
+    uint64_t value = 1469598103934665603ull;
+    void add(const char* data, size_t bytes) {
+        for (size_t i = 0; i < bytes; i += 8) {
+            uint64_t word;
+            memcpy(&word, data + i, 8);
+            value = (value ^ word) * 1099511628211ull;
         }
     }
-    cout << "Total MST cost: $" << totalCost << "\n";
+};
+
+// Function to round a section size up to the 8-byte alignment used in snapshots.
+inline size_t snapshotPadded(size_t bytes) { return (bytes + 7) & ~(size_t)7; }
+
+// Function to write one section, padded with zeros, and add it to the checksum.
+void writeSnapshotSection(ofstream& out, SnapshotChecksum& checksum, const void* data, size_t bytes) {
+    size_t whole = bytes & ~(size_t)7;
+    out.write((const char*)data, whole);
+    checksum.add((const char*)data, whole);
+    if (whole != bytes) {
+        char tail[8] = { 0 };
+        memcpy(tail, (const char*)data + whole, bytes - whole);
+        out.write(tail, 8);
+        checksum.add(tail, 8);
+    }
 }
 
-int main() {
-    // EDIT FILE PATH FOR NEW COMPUTER
-    //Here is template
+// Function to write a route graph to a snapshot file. Returns false if the file cannot be written.
+bool writeSnapshot(const RouteGraph& g, const string& filename) {
+    ofstream out(filename, ios::binary | ios::trunc);
+    if (!out) return false;
+    SnapshotHeader header = {};
+    memcpy(header.magic, SNAPSHOT_MAGIC, 8);
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.airportCount = g.airportCount;
+    header.edgeCount = g.edgeCount();
+    header.codeChars = g.code.chars.size();
+    header.cityChars = g.city.chars.size();
+    header.indexCapacity = g.codeIndex.keys.size();
+    header.indexShift = g.codeIndex.shift;
+    out.write((const char*)&header, sizeof(header)); // Rewritten with the checksum at the end.
 
-    //readCSV("C:FILEPATH put the file path here to use .csv file\\airports.csv");
-    readCSV("airports.txt");
+    SnapshotChecksum checksum;
+    writeSnapshotSection(out, checksum, g.offset.data(), g.offset.size() * sizeof(int));
+    writeSnapshotSection(out, checksum, g.destination.data(), g.destination.size() * sizeof(int));
+    writeSnapshotSection(out, checksum, g.distance.data(), g.distance.size() * sizeof(int));
+    writeSnapshotSection(out, checksum, g.cost.data(), g.cost.size() * sizeof(int));
+    writeSnapshotSection(out, checksum, g.code.offset.data(), g.code.offset.size() * sizeof(uint32_t));
+    writeSnapshotSection(out, checksum, g.city.offset.data(), g.city.offset.size() * sizeof(uint32_t));
+    writeSnapshotSection(out, checksum, g.code.chars.data(), g.code.chars.size());
+    writeSnapshotSection(out, checksum, g.city.chars.data(), g.city.chars.size());
+    writeSnapshotSection(out, checksum, g.codeIndex.keys.data(), g.codeIndex.keys.size() * sizeof(uint64_t));
+    writeSnapshotSection(out, checksum, g.codeIndex.indices.data(), g.codeIndex.indices.size() * sizeof(int));
+
+    header.checksum = checksum.value;
+    out.seekp(0);
+    out.write((const char*)&header, sizeof(header));
+    return (bool)out;
+}
+
+// Function to check the arrays of a graph read from a snapshot, so that a damaged or hand-made file
+// cannot send the searches or the code index out of bounds: offsets rise from 0 to the end of their
+// section, every leg ends at an airport and has non-negative weights, and the code index is a power
+// of two larger than the airport count (so probing always finds an empty slot), with a matching
+// shift and slots that are empty or name an airport. O(V + E + C).
+bool validSnapshotGraph(const RouteGraph& g) {
+    int v = g.airportCount, e = (int)g.destination.size();
+    if (g.offset[0] != 0 || g.offset[v] != e || g.code.offset[0] != 0 || g.code.offset[v] != g.code.chars.size()
+        || g.city.offset[0] != 0 || g.city.offset[v] != g.city.chars.size()) return false;
+    for (int u = 0; u < v; u++) {
+        if (g.offset[u] > g.offset[u + 1] || g.code.offset[u] > g.code.offset[u + 1] || g.city.offset[u] > g.city.offset[u + 1])
+            return false;
+    }
+    for (int i = 0; i < e; i++) {
+        if (g.destination[i] < 0 || g.destination[i] >= v || g.distance[i] < 0 || g.cost[i] < 0) return false;
+    }
+    size_t capacity = g.codeIndex.keys.size();
+    if (capacity == 0) return v == 0 && g.codeIndex.shift == 64;
+    if ((capacity & (capacity - 1)) != 0 || capacity <= (size_t)v) return false;
+    int shift = 64;
+    for (size_t c = capacity; c > 1; c >>= 1) shift--;
+    if (g.codeIndex.shift != shift) return false;
+    for (int index : g.codeIndex.indices) {
+        if (index < -1 || index >= v) return false;
+    }
+    return true;
+}
+
+// Function to load a snapshot into graph. The file is mapped, checked (magic, version, byte order,
+// size, checksum and validSnapshotGraph()) and its sections are copied straight into the graph
+// arrays; nothing is parsed per record. Returns false, after reporting why, if the file is missing
+// or invalid.
+bool loadSnapshot(const string& filename, RouteGraph& graph) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        cerr << "Cannot open " << filename << endl;
+        return false;
+    }
+    SnapshotHeader header;
+    if (file.size < sizeof(header)) {
+        cerr << filename << ": not a route snapshot" << endl;
+        return false;
+    }
+    memcpy(&header, file.data, sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, 8) != 0 || header.headerSize != sizeof(header)) {
+        cerr << filename << ": not a route snapshot" << endl;
+        return false;
+    }
+    if (header.version != SNAPSHOT_VERSION || header.byteOrder != SNAPSHOT_BYTE_ORDER) {
+        cerr << filename << ": unsupported snapshot version or byte order" << endl;
+        return false;
+    }
+
+    uint64_t v = header.airportCount, e = header.edgeCount, c = header.indexCapacity;
+    size_t expected = sizeof(header) + snapshotPadded((v + 1) * sizeof(int)) + 3 * snapshotPadded(e * sizeof(int))
+        + 2 * snapshotPadded((v + 1) * sizeof(uint32_t)) + snapshotPadded(header.codeChars)
+        + snapshotPadded(header.cityChars) + snapshotPadded(c * sizeof(uint64_t)) + snapshotPadded(c * sizeof(int));
+    if (v > (uint64_t)INT32_MAX || e > (uint64_t)INT32_MAX || c > file.size || header.codeChars > file.size
+        || header.cityChars > file.size || expected != file.size) {
+        cerr << filename << ": truncated or corrupt snapshot" << endl;
+        return false;
+    }
+    SnapshotChecksum checksum;
+    checksum.add(file.data + sizeof(header), file.size - sizeof(header));
+    if (checksum.value != header.checksum) {
+        cerr << filename << ": snapshot checksum mismatch" << endl;
+        return false;
+    }
+
+    // Copy each section into its array.
+    const char* cursor = file.data + sizeof(header);
+    auto take = [&](auto& target, size_t count) {
+        using T = typename remove_reference<decltype(target)>::type::value_type;
+        const T* first = (const T*)cursor;
+        target.assign(first, first + count);
+        cursor += snapshotPadded(count * sizeof(T));
+    };
+    graph = RouteGraph();
+    graph.airportCount = (int)v;
+    take(graph.offset, v + 1);
+    take(graph.destination, e);
+    take(graph.distance, e);
+    take(graph.cost, e);
+    take(graph.code.offset, v + 1);
+    take(graph.city.offset, v + 1);
+    take(graph.code.chars, header.codeChars);
+    take(graph.city.chars, header.cityChars);
+    take(graph.codeIndex.keys, c);
+    take(graph.codeIndex.indices, c);
+    graph.codeIndex.size = (int)v;
+    graph.codeIndex.shift = header.indexShift < 0 || header.indexShift > 64 ? -1 : (int)header.indexShift;
+
+    // The checksum does not cover the header, so check the structure itself.
+    if (!validSnapshotGraph(graph)) {
+        cerr << filename << ": inconsistent snapshot sections" << endl;
+        graph = RouteGraph();
+        return false;
+    }
+    graph.countInbound(); // Derived data; not stored in the snapshot.
+    return true;
+}
+
+// Function to load the route graph from a snapshot instead of the CSV.
+bool readSnapshot(const string& filename) {
+    if (!loadSnapshot(filename, routeGraph)) return false;
+    if (airportOrder != AirportOrder::Loaded) routeGraph = renumberAirports(routeGraph, airportOrdering(routeGraph, airportOrder));
+    regionIndex.build(routeGraph); // Index the airports of every state.
+    connectivity.build(routeGraph); // Components for O(1) unreachable checks.
+    reverseRoutes.build(routeGraph); // Reverse legs for searches towards a target.
+    return true;
+}
+
+//==================== INSTRUMENTATION ====================//
+// Optional per-query counters, compiled in with -DROUTE_STATS. The engines count their work with
+// ROUTE_STAT(); a query is the outermost ROUTE_STATS_SCOPE on a thread, and when it ends its wall
+// time and counters are added to log2 histograms per query kind. writeRouteStats() prints them.
+// Without ROUTE_STATS both macros expand to nothing, so the engines compile exactly as before.
+
+// Kinds of query that are timed separately.
+enum class StatsQuery { ShortestPath, Stops, Dfs, Pareto, KShortest, Hierarchy, Timetable, MST, Count };
+const char* const STATS_QUERY_NAME[] = { "shortest_path", "stops", "dfs", "pareto", "k_shortest", "hierarchy", "timetable", "mst" };
+
+// Work counted per query.
+enum StatsCounter { STAT_SETTLED, STAT_RELAXED, STAT_HEAP_OPS, STAT_DFS_NODES, STAT_COUNTERS };
+const char* const STATS_COUNTER_NAME[] = { "settled", "relaxed", "heap_ops", "dfs_nodes" };
+
+#ifdef ROUTE_STATS
+// Histogram with one bucket per bit width: bucket 0 counts zeros, bucket b counts [2^(b-1), 2^b).
+struct StatsHistogram {
+    uint64_t bucket[65] = {};
+    uint64_t count = 0, sum = 0, largest = 0;
+
+    void add(uint64_t v) {
+        int b = 0;
+        for (uint64_t x = v; x != 0; x >>= 1) b++;
+        bucket[b]++;
+        count++;
+        sum += v;
+        largest = max(largest, v);
+    }
+
+    // Function to get an upper bound of the q-quantile (0..1): the top of the bucket holding it.
+    uint64_t quantile(double q) const {
+        uint64_t rank = (uint64_t)(q * (count - 1) + 0.5), seen = 0;
+        for (int b = 0; b < 65; b++) {
+            seen += bucket[b];
+            if (seen > rank) return b == 0 ? 0 : min(largest, b == 64 ? UINT64_MAX : (uint64_t(1) << b) - 1);
+        }
+        return largest;
+    }
+};
+
+// Process-wide histograms, merged into under a lock once per query.
+struct RouteStats {
+    mutex lock;
+    StatsHistogram wallNs[(int)StatsQuery::Count];
+    StatsHistogram counter[(int)StatsQuery::Count][STAT_COUNTERS];
+};
+RouteStats routeStats;
+
+thread_local uint64_t queryCounter[STAT_COUNTERS]; // Counters of the query running on this thread.
+thread_local int queryDepth = 0;                    // Open scopes on this thread.
+
+// Scope of one query. Nested scopes (an engine called by another) add to the outer query.
+struct RouteStatsScope {
+    StatsQuery kind;
+    chrono::steady_clock::time_point start;
+
+    explicit RouteStatsScope(StatsQuery queryKind) : kind(queryKind) {
+        if (queryDepth++ > 0) return;
+        fill(queryCounter, queryCounter + STAT_COUNTERS, 0);
+        start = chrono::steady_clock::now();
+    }
+
+    ~RouteStatsScope() {
+        if (--queryDepth > 0) return;
+        uint64_t ns = (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        lock_guard<mutex> guard(routeStats.lock);
+        routeStats.wallNs[(int)kind].add(ns);
+        for (int c = 0; c < STAT_COUNTERS; c++) routeStats.counter[(int)kind][c].add(queryCounter[c]);
+    }
+};
+
+#define ROUTE_STAT(counter, n) (queryCounter[counter] += (uint64_t)(n))
+#define ROUTE_STATS_SCOPE(kind) RouteStatsScope routeStatsScope(kind)
+
+// Function to write the histograms as text: per query kind and metric, one line
+//   <query> <metric> count=N sum=S mean=M p50=X p90=X p99=X max=X buckets=b:n,b:n,...
+// where the percentiles are bucket upper bounds and bucket b holds values in [2^(b-1), 2^b).
+// Kinds that ran no query are left out.
+void writeRouteStats(ostream& out) {
+    lock_guard<mutex> guard(routeStats.lock);
+    auto line = [&](const char* query, const char* metric, const StatsHistogram& h) {
+        out << query << ' ' << metric << " count=" << h.count << " sum=" << h.sum << " mean="
+            << (h.count ? h.sum / h.count : 0) << " p50=" << h.quantile(0.5) << " p90=" << h.quantile(0.9)
+            << " p99=" << h.quantile(0.99) << " max=" << h.largest << " buckets=";
+        bool first = true;
+        for (int b = 0; b < 65; b++) {
+            if (h.bucket[b] == 0) continue;
+            out << (first ? "" : ",") << b << ':' << h.bucket[b];
+            first = false;
+        }
+        out << '\n';
+    };
+    for (int q = 0; q < (int)StatsQuery::Count; q++) {
+        if (routeStats.wallNs[q].count == 0) continue;
+        line(STATS_QUERY_NAME[q], "wall_ns", routeStats.wallNs[q]);
+        for (int c = 0; c < STAT_COUNTERS; c++) line(STATS_QUERY_NAME[q], STATS_COUNTER_NAME[c], routeStats.counter[q][c]);
+    }
+}
+
+// Function to clear every histogram.
+void resetRouteStats() {
+    lock_guard<mutex> guard(routeStats.lock);
+    for (int q = 0; q < (int)StatsQuery::Count; q++) {
+        routeStats.wallNs[q] = StatsHistogram();
+        for (int c = 0; c < STAT_COUNTERS; c++) routeStats.counter[q][c] = StatsHistogram();
+    }
+}
+#else
+#define ROUTE_STAT(counter, n) ((void)0)
+#define ROUTE_STATS_SCOPE(kind) ((void)0)
+#endif
+
+//==================== SHORTEST PATH ENGINE ====================//
+// Dijkstra over the CSR route graph with pluggable priority queues.
+// Labels are packed (distance, cost) pairs: distance in the high 32 bits, cost in the low 32 bits.
+// Adding packed edge weights adds both parts, so comparing packed labels finds the shortest route
+// and, among equally short routes, the cheapest one. Total costs must stay below 2^32.
+const uint64_t INF_KEY = UINT64_MAX; // Label of an airport that has not been reached.
+
+// Function to pack a distance and a cost into one label.
+inline uint64_t routeKey(int distance, int cost) { return ((uint64_t)distance << 32) | (uint32_t)cost; }
+inline int keyDistance(uint64_t key) { return (int)(key >> 32); }        // Distance part of a label.
+inline int keyCost(uint64_t key) { return (int)(key & 0xFFFFFFFFu); }    // Cost part of a label.
+
+// Priority queue backends for the Dijkstra engine.
+enum class HeapKind {
+    Scan,       // O(V^2) scan for the unvisited minimum (the original Task 2 loop).
+    Binary,     // Binary heap with lazy deletion of stale entries.
+    Quaternary, // Indexed 4-ary heap with decrease-key.
+    Radix       // Monotone radix heap (keys never decrease below the last popped key).
+};
+
+// Binary heap of (key, airport) entries; outdated entries are skipped when popped.
+struct BinaryHeap {
+    vector<pair<uint64_t, int>> entries; // Heap-ordered entries (smallest key first).
+
+    void clear(int) { entries.clear(); }
+    bool empty() const { return entries.empty(); }
+    void update(int node, uint64_t key) {
+        entries.push_back({ key, node });
+        push_heap(entries.begin(), entries.end(), greater<pair<uint64_t, int>>());
+    }
+    pair<uint64_t, int> pop() {
+        pop_heap(entries.begin(), entries.end(), greater<pair<uint64_t, int>>());
+        pair<uint64_t, int> top = entries.back();
+        entries.pop_back();
+        return top;
+    }
+};
+
+// Indexed 4-ary heap: every airport appears at most once and decrease-key moves it up in place.
+struct QuaternaryHeap {
+    vector<pair<uint64_t, int>> entries; // Heap-ordered entries (smallest key first).
+    vector<int> position;                // Position of each airport in entries, or -1.
+
+    void clear(int n) {
+        if ((int)position.size() != n) position.assign(n, -1);
+        for (const auto& entry : entries) position[entry.second] = -1; // Left over from an early stop.
+        entries.clear();
+    }
+    bool empty() const { return entries.empty(); }
+
+    // Function to insert an airport or lower its key.
+    void update(int node, uint64_t key) {
+        int i = position[node];
+        if (i == -1) {
+            i = (int)entries.size();
+            entries.push_back({ key, node });
+        }
+        else if (key < entries[i].first) {
+            entries[i].first = key;
+        }
+        else {
+            return;
+        }
+        siftUp(i);
+    }
+
+    // Function to remove and return the entry with the smallest key.
+    pair<uint64_t, int> pop() {
+        pair<uint64_t, int> top = entries[0];
+        position[top.second] = -1;
+        pair<uint64_t, int> last = entries.back();
+        entries.pop_back();
+        if (!entries.empty()) {
+            entries[0] = last;
+            position[last.second] = 0;
+            siftDown(0);
+        }
+        return top;
+    }
+
+    void siftUp(int i) {
+        pair<uint64_t, int> item = entries[i];
+        while (i > 0) {
+            int parent = (i - 1) / 4;
+            if (entries[parent].first <= item.first) break;
+            entries[i] = entries[parent];
+            position[entries[i].second] = i;
+            i = parent;
+        }
+        entries[i] = item;
+        position[item.second] = i;
+    }
+
+    void siftDown(int i) {
+        pair<uint64_t, int> item = entries[i];
+        int n = (int)entries.size();
+        while (true) {
+            int first = 4 * i + 1;
+            if (first >= n) break;
+            int best = first; // Smallest of up to four children.
+            int last = min(first + 4, n);
+            for (int c = first + 1; c < last; c++) {
+                if (entries[c].first < entries[best].first) best = c;
+            }
+            if (entries[best].first >= item.first) break;
+            entries[i] = entries[best];
+            position[entries[i].second] = i;
+            i = best;
+        }
+        entries[i] = item;
+        position[item.second] = i;
+    }
+};
+
+// Monotone radix heap: bucket b holds keys whose highest bit differing from the last popped key is b - 1.
+// Valid for Dijkstra because edge weights are non-negative, so no key is pushed below the last pop.
+struct RadixHeap {
+    vector<pair<uint64_t, int>> buckets[65]; // Bucket 0 holds keys equal to lastKey.
+    uint64_t lastKey = 0;                    // Key of the most recently popped entry.
+    size_t count = 0;                        // Number of entries stored.
+
+    static int bucketOf(uint64_t key, uint64_t last) {
+        return key == last ? 0 : 64 - __builtin_clzll(key ^ last);
+    }
+
+    void clear(int) {
+        for (auto& bucket : buckets) bucket.clear();
+        lastKey = 0;
+        count = 0;
+    }
+    bool empty() const { return count == 0; }
+    void update(int node, uint64_t key) {
+        buckets[bucketOf(key, lastKey)].push_back({ key, node });
+        count++;
+    }
+    pair<uint64_t, int> pop() {
+        if (buckets[0].empty()) {
+            // Find the first non-empty bucket and redistribute it around its minimum key.
+            int b = 1;
+            while (buckets[b].empty()) b++;
+            uint64_t minKey = buckets[b][0].first;
+            for (const auto& entry : buckets[b]) minKey = min(minKey, entry.first);
+            lastKey = minKey;
+            for (const auto& entry : buckets[b]) buckets[bucketOf(entry.first, lastKey)].push_back(entry);
+            buckets[b].clear();
+        }
+        pair<uint64_t, int> top = buckets[0].back();
+        buckets[0].pop_back();
+        count--;
+        return top;
+    }
+};
+
+// Per-search state. Reusing one scratch object across queries avoids reallocating the arrays, and
+// only the entries the last search touched are reset, so a short query does not pay O(V) to start.
+struct DijkstraScratch {
+    vector<uint64_t> key;   // Best label found for each airport.
+    vector<int> prev;       // Predecessor of each airport on its best route, or -1.
+    vector<char> settled;   // Whether each airport's label is final.
+    vector<char> isTarget;  // Whether each airport is one of the search targets.
+    vector<int> touched;    // Airports whose entries the last search wrote.
+    int targetsLeft = -1;   // Targets not yet settled; -1 settles the whole graph.
+    BinaryHeap binaryHeap;
+    QuaternaryHeap quaternaryHeap;
+    RadixHeap radixHeap;
+
+    // Function to reset the arrays for a graph with n airports.
+    void prepare(int n) {
+        if ((int)key.size() != n) {
+            key.assign(n, INF_KEY);
+            prev.assign(n, -1);
+            settled.assign(n, 0);
+            isTarget.assign(n, 0);
+        }
+        else {
+            for (int v : touched) {
+                key[v] = INF_KEY;
+                prev[v] = -1;
+                settled[v] = 0;
+                isTarget[v] = 0;
+            }
+        }
+        touched.clear();
+        targetsLeft = -1;
+    }
+
+    // Function to give v its first label.
+    void reach(int v, uint64_t label) {
+        key[v] = label;
+        touched.push_back(v);
+    }
+
+    // Function to register the search targets (duplicates are counted once).
+    void setTargets(const int* targets, int count) {
+        if (count == 0) return;
+        targetsLeft = 0;
+        for (int i = 0; i < count; i++) {
+            if (!isTarget[targets[i]]) {
+                isTarget[targets[i]] = 1;
+                touched.push_back(targets[i]);
+                targetsLeft++;
+            }
+        }
+    }
+
+    // Function to mark u settled; returns true once every target is settled.
+    bool settle(int u) {
+        settled[u] = 1;
+        return isTarget[u] && --targetsLeft == 0;
+    }
+
+    bool reached(int v) const { return key[v] != INF_KEY; } // Whether v has a route from the origin.
+    int distance(int v) const { return keyDistance(key[v]); } // Route length to v.
+    int cost(int v) const { return keyCost(key[v]); }         // Route cost to v.
+};
+
+// Dijkstra main loop shared by the heap backends.
+template <class Heap>
+void dijkstraWithHeap(const RouteGraph& g, int origin, DijkstraScratch& s, Heap& heap) {
+    heap.clear(g.airportCount);
+    s.reach(origin, 0);
+    heap.update(origin, 0);
+    ROUTE_STAT(STAT_HEAP_OPS, 1);
+    while (!heap.empty()) {
+        pair<uint64_t, int> top = heap.pop();
+        ROUTE_STAT(STAT_HEAP_OPS, 1);
+        int u = top.second;
+        if (s.settled[u] || top.first != s.key[u]) continue; // Skip outdated entries.
+        ROUTE_STAT(STAT_SETTLED, 1);
+        if (s.settle(u)) break; // Early termination: every target's label is final.
+
+        uint64_t ku = s.key[u];
+        ROUTE_STAT(STAT_RELAXED, g.offset[u + 1] - g.offset[u]);
+        for (int e = g.offset[u]; e < g.offset[u + 1]; e++) {
+            int v = g.destination[e];
+            if (s.settled[v]) continue;
+            uint64_t kv = ku + routeKey(g.distance[e], g.cost[e]);
+            if (kv < s.key[v]) {
+                if (s.key[v] == INF_KEY) s.touched.push_back(v);
+                s.key[v] = kv;
+                s.prev[v] = u;
+                heap.update(v, kv);
+                ROUTE_STAT(STAT_HEAP_OPS, 1);
+            }
+        }
+    }
+}
+
+// The original O(V^2) loop: repeatedly scan every airport for the unsettled minimum.
+void dijkstraScan(const RouteGraph& g, int origin, DijkstraScratch& s) {
+    s.reach(origin, 0);
+    for (int count = 0; count < g.airportCount; count++) {
+        int u = -1;
+        uint64_t minKey = INF_KEY;
+        for (int i = 0; i < g.airportCount; i++) {
+            if (!s.settled[i] && s.key[i] < minKey) {
+                minKey = s.key[i];
+                u = i;
+            }
+        }
+        if (u == -1) break;
+        ROUTE_STAT(STAT_SETTLED, 1);
+        if (s.settle(u)) break;
+
+        ROUTE_STAT(STAT_RELAXED, g.offset[u + 1] - g.offset[u]);
+        for (int e = g.offset[u]; e < g.offset[u + 1]; e++) {
+            int v = g.destination[e];
+            uint64_t kv = minKey + routeKey(g.distance[e], g.cost[e]);
+            if (!s.settled[v] && kv < s.key[v]) {
+                if (s.key[v] == INF_KEY) s.touched.push_back(v);
+                s.key[v] = kv;
+                s.prev[v] = u;
+            }
+        }
+    }
+}
+
+// Function to run one Dijkstra search from origin that stops once every listed target is settled.
+// With targetCount == 0 the whole graph is settled. Results are left in s.
+void dijkstraToTargets(const RouteGraph& g, int origin, const int* targets, int targetCount, HeapKind heap, DijkstraScratch& s) {
+    ROUTE_STATS_SCOPE(StatsQuery::ShortestPath);
+    s.prepare(g.airportCount);
+    s.setTargets(targets, targetCount);
+    switch (heap) {
+    case HeapKind::Scan:       dijkstraScan(g, origin, s); break;
+    case HeapKind::Binary:     dijkstraWithHeap(g, origin, s, s.binaryHeap); break;
+    case HeapKind::Quaternary: dijkstraWithHeap(g, origin, s, s.quaternaryHeap); break;
+    case HeapKind::Radix:      dijkstraWithHeap(g, origin, s, s.radixHeap); break;
+    }
+}
+
+// Function to run Dijkstra from origin. With target == -1 the whole graph is settled;
+// otherwise the search stops as soon as target is popped. Results are left in s.
+void dijkstra(const RouteGraph& g, int origin, int target, HeapKind heap, DijkstraScratch& s) {
+    dijkstraToTargets(g, origin, &target, target == -1 ? 0 : 1, heap, s);
+}
+
+HeapKind defaultHeap = HeapKind::Radix; // Backend used by the tasks below (fastest in --bench-dijkstra).
+
+// Outcome of one route query. The airports on the route are written to a path buffer owned by
+// the caller, so repeated queries reuse its capacity instead of allocating a vector per result.
+struct RouteResult {
+    bool found = false; // Whether a route exists.
+    int distance = 0;   // Route length (valid when found).
+    int cost = 0;       // Route cost (valid when found).
+};
+
+// Function to write the route from the search origin to v into path, origin first. The hops are
+// counted first so the buffer is filled front to back in place, with no reversal.
+void tracePath(const DijkstraScratch& s, int v, vector<int>& path) {
+    int hops = 0;
+    for (int at = v; at != -1; at = s.prev[at]) hops++;
+    path.resize(hops);
+    for (int at = v; at != -1; at = s.prev[at]) path[--hops] = at;
+}
+
+// Function to find the shortest route from origin to destination. The route goes to path
+// (cleared when there is none); the search arrays stay in s.
+RouteResult shortestRoute(const RouteGraph& g, int origin, int destination, HeapKind heap,
+    DijkstraScratch& s, vector<int>& path) {
+    RouteResult route;
+    path.clear();
+    dijkstra(g, origin, destination, heap, s); // Stops once the destination is settled.
+    if (!s.reached(destination)) return route;
+    route = { true, s.distance(destination), s.cost(destination) };
+    tracePath(s, destination, path);
+    return route;
+}
+
+// Routes from one origin to several targets. The paths are stored back to back in one buffer,
+// so a RouteSet reused across queries stops allocating once it has grown.
+struct RouteSet {
+    vector<RouteResult> routes; // One per target, in target order.
+    vector<int> pathStart;      // routes.size() + 1 entries; route i is paths[pathStart[i] .. pathStart[i + 1]).
+    vector<int> paths;          // Airports of every route, each origin first (unreachable targets add none).
+
+    int size() const { return (int)routes.size(); }
+    const int* path(int i) const { return paths.data() + pathStart[i]; }
+    int pathLength(int i) const { return pathStart[i + 1] - pathStart[i]; }
+};
+
+// Function to find the shortest route from origin to each target with a single search.
+// All routes come from the one predecessor array, so K targets cost one search instead of K.
+void shortestRoutesToMany(const RouteGraph& g, int origin, const vector<int>& targets,
+    HeapKind heap, DijkstraScratch& s, RouteSet& out) {
+    out.routes.clear();
+    out.pathStart.assign(1, 0);
+    out.paths.clear();
+    if (!targets.empty()) dijkstraToTargets(g, origin, targets.data(), (int)targets.size(), heap, s);
+    for (int t : targets) {
+        RouteResult route;
+        if (s.reached(t)) {
+            route = { true, s.distance(t), s.cost(t) };
+            int hops = 0;
+            for (int at = t; at != -1; at = s.prev[at]) hops++;
+            size_t end = out.paths.size() + hops;
+            out.paths.resize(end);
+            for (int at = t; at != -1; at = s.prev[at]) out.paths[--end] = at;
+        }
+        out.routes.push_back(route);
+        out.pathStart.push_back((int)out.paths.size());
+    }
+}
+
+//==================== BATCH SHORTEST PATHS ====================//
+// Many-to-all distance and cost matrices for pricing, computed without printing.
+
+// Storage order of a result matrix.
+enum class MatrixLayout {
+    Dense, // Row-major: one row per origin.
+    Tiled  // TILE x TILE blocks, row-major inside each block, for blocked consumers.
+};
+
+// Distance and cost from each requested origin (row) to every airport (column); INF if unreachable.
+struct RouteMatrix {
+    static const int TILE = 64;          // Tile edge length for MatrixLayout::Tiled.
+    MatrixLayout layout = MatrixLayout::Dense;
+    int rows = 0, columns = 0;           // Number of origins and of airports.
+    vector<int> origin;                  // Origin airport of each row.
+    vector<int> distance, cost;          // Matrix entries in layout order.
+
+    // Function to size the matrix for the given origins and airport count.
+    void resize(const vector<int>& origins, int airportCount, MatrixLayout order) {
+        layout = order;
+        origin = origins;
+        rows = (int)origins.size();
+        columns = airportCount;
+        size_t entries = layout == MatrixLayout::Dense ? (size_t)rows * columns
+            : (size_t)((rows + TILE - 1) / TILE) * ((columns + TILE - 1) / TILE) * TILE * TILE;
+        distance.assign(entries, INF);
+        cost.assign(entries, INF);
+    }
+
+    // Function to locate entry (row, column) in the distance and cost arrays.
+    size_t index(int row, int column) const {
+        if (layout == MatrixLayout::Dense) return (size_t)row * columns + column;
+        size_t tilesPerRow = (columns + TILE - 1) / TILE;
+        size_t tile = (size_t)(row / TILE) * tilesPerRow + column / TILE;
+        return tile * TILE * TILE + (size_t)(row % TILE) * TILE + column % TILE;
+    }
+    int distanceAt(int row, int column) const { return distance[index(row, column)]; }
+    int costAt(int row, int column) const { return cost[index(row, column)]; }
+};
+
+// Function to fill a route matrix for the given origins (every airport if origins is empty).
+// Each origin is an independent full Dijkstra search; searches run on the pool with work stealing,
+// and every worker reuses its own scratch. Rows only depend on their origin, so the result is the
+// same for any thread count.
+void batchShortestPaths(const RouteGraph& g, vector<int> origins, MatrixLayout layout, ThreadPool& pool,
+    RouteMatrix& matrix) {
+    if (origins.empty()) {
+        origins.resize(g.airportCount);
+        for (int i = 0; i < g.airportCount; i++) origins[i] = i;
+    }
+    matrix.resize(origins, g.airportCount, layout);
+    vector<DijkstraScratch> scratch(pool.size());
+    pool.runStealing(matrix.rows, [&](int row, int worker) {
+        DijkstraScratch& s = scratch[worker];
+        dijkstra(g, matrix.origin[row], -1, defaultHeap, s);
+        for (int v = 0; v < g.airportCount; v++) {
+            if (!s.reached(v)) continue;
+            size_t at = matrix.index(row, v);
+            matrix.distance[at] = s.distance(v);
+            matrix.cost[at] = s.cost(v);
+        }
+    });
+}
+
+//==================== PARETO ROUTE SEARCH ====================//
+// Multi-criteria label-setting search over (distance, cost). Every airport keeps a bag of labels, one
+// per non-dominated route found so far. Two reverse Dijkstra searches from the target give exact lower
+// bounds on the distance and on the cost still to go, and labels leave the heap in packed order of
+// (distance + distance bound, cost + cost bound). At one airport that is plain (distance, cost) order,
+// so a popped label is final unless an earlier, therefore no longer, label there is at most as
+// expensive: each airport only needs its cheapest final cost. The bounds also stop the search from
+// spreading away from the target, and drop any label that cannot beat a route already found.
+
+// One route on the Pareto frontier.
+struct ParetoRoute {
+    int distance = 0;  // Route length.
+    int cost = 0;      // Route cost.
+    vector<int> path;  // Airport indices from origin to destination.
+};
+
+// Pareto frontier between two airports, shortest (and dearest) route first, cheapest last.
+struct ParetoResult {
+    vector<ParetoRoute> routes;
+    int labels = 0;         // Labels created by the search.
+    bool truncated = false; // The label limit was hit; routes is then only part of the frontier.
+};
+
+// Search arrays reused between Pareto queries. The bounds come from two reverse searches from the
+// target, one by distance and one by cost, which only settle as far as a Pareto route can reach:
+// no Pareto route is longer than the cheapest route or dearer than the shortest one, so an airport
+// beyond either limit is left unsettled and treated as a dead end.
+struct ParetoScratch {
+    vector<uint64_t> labelKey;     // Packed (distance, cost) of each label.
+    vector<int> labelAirport;      // Airport of each label.
+    vector<int> labelParent;       // Label this one extends, or -1 at the origin.
+    vector<int> cheapestFinal;     // Cost of the cheapest final label at each airport, INF if none.
+    vector<int> finalTouched;      // Airports whose cheapestFinal was set by the last query.
+    vector<pair<uint64_t, int>> heap; // (bounded key, label) min-heap; dominated labels are skipped when popped.
+    DijkstraScratch byDistance;    // Reverse search by (distance, cost) from the target.
+    DijkstraScratch byCost;        // Reverse search by (cost, distance) from the target.
+    RadixHeap distanceHeap, costHeap; // Open entries of the two reverse searches.
+
+    // Shortest distance and lowest cost from v to the target, INF where v is out of bounds.
+    int distanceBound(int v) const { return byDistance.settled[v] ? byDistance.distance(v) : INF; }
+    int costBound(int v) const { return byCost.settled[v] ? keyDistance(byCost.key[v]) : INF; }
+
+    // Function to reset the arrays and compute the bounds from origin towards target. Returns false
+    // if the target cannot be reached.
+    bool prepare(const RouteGraph& g, const ReverseRoutes& reverse, int origin, int target) {
+        labelKey.clear();
+        labelAirport.clear();
+        labelParent.clear();
+        heap.clear();
+        if ((int)cheapestFinal.size() != g.airportCount) cheapestFinal.assign(g.airportCount, INF);
+        for (int v : finalTouched) cheapestFinal[v] = INF;
+        finalTouched.clear();
+
+        startBound(reverse.byDistance, target, byDistance, distanceHeap);
+        startBound(reverse.byCost, target, byCost, costHeap);
+        growBound(reverse.byDistance, byDistance, distanceHeap, origin, 0);
+        if (!byDistance.settled[origin]) return false;
+        growBound(reverse.byCost, byCost, costHeap, origin, 0);
+        // The shortest route is the dearest and the cheapest route the longest Pareto route.
+        int longest = keyCost(byCost.key[origin]), dearest = byDistance.cost(origin);
+        growBound(reverse.byDistance, byDistance, distanceHeap, -1, routeKey(longest, 0) | 0xFFFFFFFFu);
+        growBound(reverse.byCost, byCost, costHeap, -1, routeKey(dearest, 0) | 0xFFFFFFFFu);
+        return true;
+    }
+
+    static void startBound(const RouteGraph& r, int target, DijkstraScratch& d, RadixHeap& open) {
+        d.prepare(r.airportCount);
+        open.clear(r.airportCount);
+        d.reach(target, 0);
+        open.update(target, 0);
+    }
+
+    // Function to continue a reverse search until stop is settled (stop == -1: at once) and every
+    // open key is above limit.
+    static void growBound(const RouteGraph& r, DijkstraScratch& d, RadixHeap& open, int stop, uint64_t limit) {
+        while (!open.empty()) {
+            auto [ku, u] = open.pop();
+            ROUTE_STAT(STAT_HEAP_OPS, 1);
+            if (d.settled[u] || ku != d.key[u]) continue; // Outdated entry.
+            if ((stop == -1 || d.settled[stop]) && ku > limit) {
+                open.update(u, ku); // ku is the last popped key, so the radix heap takes it back.
+                break;
+            }
+            d.settled[u] = 1;
+            ROUTE_STAT(STAT_SETTLED, 1);
+            ROUTE_STAT(STAT_RELAXED, r.offset[u + 1] - r.offset[u]);
+            for (int e = r.offset[u]; e < r.offset[u + 1]; e++) {
+                int v = r.destination[e];
+                uint64_t kv = ku + routeKey(r.distance[e], r.cost[e]);
+                if (!d.settled[v] && kv < d.key[v]) {
+                    if (d.key[v] == INF_KEY) d.touched.push_back(v);
+                    d.key[v] = kv;
+                    d.prev[v] = u;
+                    open.update(v, kv);
+                    ROUTE_STAT(STAT_HEAP_OPS, 1);
+                }
+            }
+        }
+    }
+
+    void addLabel(uint64_t key, int airport, int parent) {
+        labelKey.push_back(key);
+        labelAirport.push_back(airport);
+        labelParent.push_back(parent);
+        heap.push_back({ key + routeKey(distanceBound(airport), costBound(airport)), (int)labelKey.size() - 1 });
+        push_heap(heap.begin(), heap.end(), greater<pair<uint64_t, int>>());
+    }
+};
+
+// Function to find every Pareto-optimal (distance, cost) route from origin to target.
+// A label is dropped as soon as it is no cheaper than a final label at its airport, or its cost plus
+// the cost bound is no lower than the cheapest route found, since every extension of it would then be
+// dominated. At most maxLabels labels are created; past that the search stops and returns the routes
+// found so far, marked truncated. The bounds lead straight to the target, so the shortest route is
+// normally among them. reversed must be the reverse of g.
+ParetoResult paretoRoutes(const RouteGraph& g, const ReverseRoutes& reversed, int origin, int target, ParetoScratch& s,
+    int maxLabels = 1 << 20) {
+    ROUTE_STATS_SCOPE(StatsQuery::Pareto);
+    ParetoResult result;
+    if (!s.prepare(g, reversed, origin, target)) return result; // Target unreachable.
+    s.addLabel(routeKey(0, 0), origin, -1);
+    while (!s.heap.empty()) {
+        pop_heap(s.heap.begin(), s.heap.end(), greater<pair<uint64_t, int>>());
+        int label = s.heap.back().second;
+        s.heap.pop_back();
+        ROUTE_STAT(STAT_HEAP_OPS, 1);
+        uint64_t key = s.labelKey[label];
+        int u = s.labelAirport[label];
+        int cost = keyCost(key);
+        if (cost >= s.cheapestFinal[u] || cost + s.costBound(u) >= s.cheapestFinal[target]) continue; // Dominated.
+        if (s.cheapestFinal[u] == INF) s.finalTouched.push_back(u);
+        s.cheapestFinal[u] = cost;
+        ROUTE_STAT(STAT_SETTLED, 1);
+
+        if (u == target) {
+            ParetoRoute route;
+            route.distance = keyDistance(key);
+            route.cost = cost;
+            for (int l = label; l != -1; l = s.labelParent[l]) route.path.push_back(s.labelAirport[l]);
+            reverse(route.path.begin(), route.path.end());
+            result.routes.push_back(move(route));
+            continue; // Extensions through the target are dominated by the route itself.
+        }
+        for (int e = g.offset[u]; e < g.offset[u + 1]; e++) {
+            int v = g.destination[e];
+            if (s.distanceBound(v) == INF || s.costBound(v) == INF) continue; // No Pareto route on from v.
+            int nextCost = cost + g.cost[e];
+            if (nextCost >= s.cheapestFinal[v] || nextCost + s.costBound(v) >= s.cheapestFinal[target]) continue;
+            if ((int)s.labelKey.size() >= maxLabels) {
+                result.truncated = true;
+                s.heap.clear();
+                break;
+            }
+            s.addLabel(key + routeKey(g.distance[e], g.cost[e]), v, label);
+            ROUTE_STAT(STAT_HEAP_OPS, 1);
+        }
+        ROUTE_STAT(STAT_RELAXED, g.offset[u + 1] - g.offset[u]);
+    }
+    result.labels = (int)s.labelKey.size();
+    return result;
+}
+
+//==================== K SHORTEST ROUTES ====================//
+// Alternative itineraries: the k best loopless routes between two airports (Yen's algorithm with
+// Lawler's rule). Route k + 1 leaves one of the first k routes at a "spur" airport after sharing its
+// prefix (the root), so each new route only needs spur searches along the last route accepted, from
+// the airport where it left its parent onwards, with the root airports and the already used next
+// legs removed. One reverse Dijkstra from the target gives every airport its exact remaining weight
+// and its next hop towards the target (the reverse shortest-path tree). Spur searches are A* with that
+// weight as the heuristic, and stop at the first airport whose tree route avoids every removed airport,
+// since that route is then the best completion. A spur search is also cut off once it cannot beat the
+// candidate that would currently be ranked k-th. With an exact heuristic a spur search settles little
+// more than the spur route itself, so k routes cost one full reverse search plus k short searches.
+
+// What alternative routes are ranked by; the other criterion breaks ties.
+enum class RouteRank { Distance, Cost };
+
+// One candidate route waiting to be ranked.
+struct KRouteCandidate {
+    uint64_t key;     // Packed weight under the ranking.
+    vector<int> path; // Airports, origin first.
+    int deviation;    // Index of the spur airport where it leaves its parent route.
+
+    bool operator>(const KRouteCandidate& other) const {
+        return key != other.key ? key > other.key : path > other.path;
+    }
+};
+
+// Search arrays reused between k-shortest queries.
+struct KShortestScratch {
+    DijkstraScratch tree;           // Reverse search from the target: remaining weight and next hop.
+    vector<uint64_t> bestKey;       // A* weight from the spur airport.
+    vector<int> parent;             // A* predecessor.
+    vector<int> closedStamp;        // Equal to stamp once settled in the current spur search.
+    vector<int> blockedStamp;       // Equal to stamp for root airports of the current spur.
+    vector<int> onPathStamp;        // Marks the A* prefix while a route is assembled.
+    vector<int> touched;            // Airports whose bestKey was set in the current spur search.
+    vector<pair<uint64_t, int>> heap; // (weight + remaining weight, airport) min-heap.
+    vector<int> removedNext;        // Next airports that may not follow the spur airport.
+    vector<int> spurPath;           // Route found by the last spur search, spur airport first.
+    vector<KRouteCandidate> candidates; // Min-heap of routes not ranked yet.
+    vector<uint64_t> candidateKeys; // Candidate weights, for the pruning bound.
+    vector<vector<int>> accepted;   // Routes ranked so far, best first.
+    vector<int> acceptedDeviation;  // Deviation index of each accepted route.
+    int stamp = 0;
+
+    void prepare(int n) {
+        if ((int)bestKey.size() != n) {
+            bestKey.assign(n, INF_KEY);
+            parent.assign(n, -1);
+            closedStamp.assign(n, 0);
+            blockedStamp.assign(n, 0);
+            onPathStamp.assign(n, 0);
+            stamp = 0;
+        }
+        candidates.clear();
+        accepted.clear();
+        acceptedDeviation.clear();
+    }
+
+    // Function to start a new spur search: fresh stamps and no open labels.
+    void nextStamp() {
+        for (int v : touched) {
+            bestKey[v] = INF_KEY;
+            parent[v] = -1;
+        }
+        touched.clear();
+        heap.clear();
+        stamp++;
+    }
+};
+
+// Function to get the weight of leg e under a ranking.
+inline uint64_t rankKey(const RouteGraph& g, int e, RouteRank rank) {
+    return rank == RouteRank::Distance ? routeKey(g.distance[e], g.cost[e]) : routeKey(g.cost[e], g.distance[e]);
+}
+
+// Function to find the best spur route from spur to target that avoids the blocked airports and does
+// not start with a removed next airport. Returns its weight, or INF_KEY if there is none lighter than
+// limit; the route is left in s.spurPath.
+uint64_t spurSearch(const RouteGraph& g, const RouteGraph& reversed, int spur, int target, RouteRank rank, uint64_t limit,
+    KShortestScratch& s) {
+    const vector<uint64_t>& remaining = s.tree.key;
+    const vector<int>& nextHop = s.tree.prev; // Next airport towards the target on the tree.
+    s.spurPath.clear();
+    // Every route ends with a leg into the target. If none of them can be used, the search would
+    // otherwise settle everything reachable before failing.
+    bool open = false;
+    for (int e = reversed.offset[target]; !open && e < reversed.offset[target + 1]; e++) {
+        int w = reversed.destination[e];
+        open = s.blockedStamp[w] != s.stamp
+            && (w != spur || find(s.removedNext.begin(), s.removedNext.end(), target) == s.removedNext.end());
+    }
+    if (!open) return INF_KEY;
+    s.bestKey[spur] = 0;
+    s.touched.push_back(spur);
+    s.heap.push_back({ remaining[spur], spur });
+    while (!s.heap.empty()) {
+        pop_heap(s.heap.begin(), s.heap.end(), greater<pair<uint64_t, int>>());
+        auto [f, u] = s.heap.back();
+        s.heap.pop_back();
+        ROUTE_STAT(STAT_HEAP_OPS, 1);
+        if (s.closedStamp[u] == s.stamp || f != s.bestKey[u] + remaining[u]) continue; // Stale entry.
+        if (f > limit) break; // Every route still open is too heavy.
+        s.closedStamp[u] = s.stamp;
+        ROUTE_STAT(STAT_SETTLED, 1);
+
+        // Finish along the tree if its route from u is still open and does not meet the prefix.
+        for (int v = u; v != -1; v = s.parent[v]) s.onPathStamp[v] = s.stamp;
+        bool clean = true;
+        for (int v = nextHop[u]; clean && v != -1; v = nextHop[v]) {
+            clean = s.blockedStamp[v] != s.stamp && s.onPathStamp[v] != s.stamp;
+        }
+        if (clean && u == spur && find(s.removedNext.begin(), s.removedNext.end(), nextHop[u]) != s.removedNext.end()) {
+            clean = false; // The tree leaves the spur airport by a removed leg.
+        }
+        if (clean) {
+            for (int v = u; v != -1; v = s.parent[v]) s.spurPath.push_back(v);
+            reverse(s.spurPath.begin(), s.spurPath.end());
+            for (int v = nextHop[u]; v != -1; v = nextHop[v]) s.spurPath.push_back(v);
+            for (int v = u; v != -1; v = s.parent[v]) s.onPathStamp[v] = 0;
+            return f;
+        }
+        for (int v = u; v != -1; v = s.parent[v]) s.onPathStamp[v] = 0;
+
+        ROUTE_STAT(STAT_RELAXED, g.offset[u + 1] - g.offset[u]);
+        for (int e = g.offset[u]; e < g.offset[u + 1]; e++) {
+            int v = g.destination[e];
+            if (remaining[v] == INF_KEY || s.blockedStamp[v] == s.stamp || s.closedStamp[v] == s.stamp) continue;
+            if (u == spur && find(s.removedNext.begin(), s.removedNext.end(), v) != s.removedNext.end()) continue;
+            uint64_t k = s.bestKey[u] + rankKey(g, e, rank);
+            if (k < s.bestKey[v]) {
+                if (s.bestKey[v] == INF_KEY) s.touched.push_back(v);
+                s.bestKey[v] = k;
+                s.parent[v] = u;
+                s.heap.push_back({ k + remaining[v], v });
+                push_heap(s.heap.begin(), s.heap.end(), greater<pair<uint64_t, int>>());
+                ROUTE_STAT(STAT_HEAP_OPS, 1);
+            }
+        }
+    }
+    return INF_KEY;
+}
+
+// Function to get the weight of the best leg from u to v under a ranking.
+uint64_t bestLegKey(const RouteGraph& g, int u, int v, RouteRank rank) {
+    uint64_t best = INF_KEY;
+    for (int e = g.offset[u]; e < g.offset[u + 1]; e++) {
+        if (g.destination[e] == v) best = min(best, rankKey(g, e, rank));
+    }
+    return best;
+}
+
+// Function to find up to k loopless routes from origin to target, best first under rank (ties by the
+// other criterion, then by airport sequence). Routes are node sequences: between two airports the best
+// leg is used. reversed must be the reverse of g. The routes go to out; returns how many were found.
+int kShortestRoutes(const RouteGraph& g, const ReverseRoutes& reversed, int origin, int target, int k, RouteRank rank,
+    KShortestScratch& s, RouteSet& out) {
+    ROUTE_STATS_SCOPE(StatsQuery::KShortest);
+    out.routes.clear();
+    out.pathStart.assign(1, 0);
+    out.paths.clear();
+    s.prepare(g.airportCount);
+    if (k <= 0 || origin == target) return 0;
+
+    const RouteGraph& r = rank == RouteRank::Distance ? reversed.byDistance : reversed.byCost;
+    dijkstra(r, target, -1, defaultHeap, s.tree);
+    if (!s.tree.reached(origin)) return 0;
+
+    // The best route is the tree route itself.
+    s.candidates.push_back({ s.tree.key[origin], {}, 0 });
+    for (int v = origin; v != -1; v = s.tree.prev[v]) s.candidates.back().path.push_back(v);
+
+    while (!s.candidates.empty() && (int)s.accepted.size() < k) {
+        pop_heap(s.candidates.begin(), s.candidates.end(), greater<KRouteCandidate>());
+        KRouteCandidate best = move(s.candidates.back());
+        s.candidates.pop_back();
+        s.accepted.push_back(move(best.path));
+        s.acceptedDeviation.push_back(best.deviation);
+        if ((int)s.accepted.size() == k) break;
+
+        const vector<int>& last = s.accepted.back();
+        uint64_t rootKey = 0; // Weight of last[0 .. i].
+        for (int i = 0; i < best.deviation; i++) rootKey += bestLegKey(g, last[i], last[i + 1], rank);
+        for (int i = best.deviation; i + 1 < (int)last.size(); i++) {
+            if (i > best.deviation) rootKey += bestLegKey(g, last[i - 1], last[i], rank);
+            int spur = last[i];
+            s.nextStamp();
+            for (int j = 0; j < i; j++) s.blockedStamp[last[j]] = s.stamp;
+            // Next legs already used by ranked routes that share this root.
+            s.removedNext.clear();
+            for (const vector<int>& route : s.accepted) {
+                if ((int)route.size() > i + 1 && equal(last.begin(), last.begin() + i + 1, route.begin())) {
+                    s.removedNext.push_back(route[i + 1]);
+                }
+            }
+            // A spur route heavier than the needed-th best candidate cannot make the first k.
+            uint64_t limit = INF_KEY;
+            int needed = k - (int)s.accepted.size();
+            if ((int)s.candidates.size() >= needed) {
+                s.candidateKeys.clear();
+                for (const KRouteCandidate& c : s.candidates) s.candidateKeys.push_back(c.key);
+                nth_element(s.candidateKeys.begin(), s.candidateKeys.begin() + needed - 1, s.candidateKeys.end());
+                limit = s.candidateKeys[needed - 1] - rootKey;
+                if (s.candidateKeys[needed - 1] < rootKey + s.tree.key[spur]) continue; // Even the best spur is too heavy.
+            }
+            uint64_t spurKey = spurSearch(g, r, spur, target, rank, limit, s);
+            if (spurKey == INF_KEY) continue;
+
+            KRouteCandidate candidate{ rootKey + spurKey, vector<int>(last.begin(), last.begin() + i), i };
+            candidate.path.insert(candidate.path.end(), s.spurPath.begin(), s.spurPath.end());
+            bool known = false;
+            for (const KRouteCandidate& other : s.candidates) {
+                if (other.key == candidate.key && other.path == candidate.path) {
+                    known = true;
+                    break;
+                }
+            }
+            if (known) continue;
+            s.candidates.push_back(move(candidate));
+            push_heap(s.candidates.begin(), s.candidates.end(), greater<KRouteCandidate>());
+        }
+    }
+
+    for (const vector<int>& route : s.accepted) {
+        uint64_t key = 0;
+        for (size_t i = 0; i + 1 < route.size(); i++) key += bestLegKey(g, route[i], route[i + 1], rank);
+        int first = keyDistance(key), second = keyCost(key);
+        if (rank == RouteRank::Distance) out.routes.push_back({ true, first, second });
+        else out.routes.push_back({ true, second, first });
+        out.paths.insert(out.paths.end(), route.begin(), route.end());
+        out.pathStart.push_back((int)out.paths.size());
+    }
+    return out.size();
+}
+
+//==================== CONTRACTION HIERARCHY ====================//
+// Shortcut index for fast point-to-point queries. Airports are contracted one at a time, least
+// important first; contracting v removes it and adds a shortcut u -> w for every route u -> v -> w
+// that no other route in the remaining graph matches (found by a bounded "witness" search). Every
+// arc then leads from an airport to a more important one (upward) or the other way (downward), and
+// a query only searches upward: forward from the origin and backward from the target.
+// Weights are packed (distance, cost) labels, so the hierarchy gives the same lengths and costs as
+// dijkstra(). Contraction stops at a core once the remaining graph gets dense; the core keeps all of
+// its arcs in both lists and is searched like a plain graph.
+
+// Hierarchy arrays. Airport v's upward arcs are [upOffset[v], upOffset[v + 1]) (v -> upTarget);
+// its downward arcs are [downOffset[v], downOffset[v + 1]), stored reversed (downSource -> v).
+// A shortcut records the airport it skips (middle); original legs have middle -1.
+struct ContractionHierarchy {
+    int airportCount = 0;
+    int coreSize = 0;          // Airports left uncontracted.
+    uint64_t fingerprint = 0;  // graphFingerprint() of the graph it was built for.
+    vector<int> rank;          // Contraction order; core airports come last.
+    vector<int> upOffset, upTarget, upMiddle;
+    vector<uint64_t> upWeight;
+    vector<int> downOffset, downSource, downMiddle;
+    vector<uint64_t> downWeight;
+
+    int shortcutCount() const {
+        int count = 0;
+        for (int m : upMiddle) count += m != -1;
+        for (int m : downMiddle) count += m != -1;
+        return count;
+    }
+};
+
+// Function to hash the structure and weights of a route graph, to tie a hierarchy to it.
+uint64_t graphFingerprint(const RouteGraph& g) {
+    SnapshotChecksum checksum;
+    uint64_t count = g.airportCount;
+    checksum.add((const char*)&count, 8);
+    for (const vector<int>* section : { &g.offset, &g.destination, &g.distance, &g.cost }) {
+        size_t whole = section->size() * sizeof(int) & ~(size_t)7;
+        checksum.add((const char*)section->data(), whole);
+        if (section->size() % 2 == 1) {
+            uint64_t tail = (uint32_t)section->back();
+            checksum.add((const char*)&tail, 8);
+        }
+    }
+    return checksum.value;
+}
+
+// Remaining graph during contraction.
+struct ContractionGraph {
+    struct Arc {
+        int node;        // Other end.
+        int middle;      // Skipped airport of a shortcut, or -1.
+        uint64_t weight; // Packed (distance, cost).
+    };
+    vector<vector<Arc>> out, in; // Arcs of each remaining airport, one per neighbor.
+    vector<char> contracted;
+    long long arcCount = 0;      // Arcs between remaining airports.
+
+    // Function to add an arc, or lower the weight of the existing one between the same airports.
+    void addArc(int u, int v, uint64_t weight, int middle) {
+        for (Arc& arc : out[u]) {
+            if (arc.node != v) continue;
+            if (weight < arc.weight) {
+                arc = { v, middle, weight };
+                for (Arc& back : in[v]) {
+                    if (back.node == u) back = { u, middle, weight };
+                }
+            }
+            return;
+        }
+        out[u].push_back({ v, middle, weight });
+        in[v].push_back({ u, middle, weight });
+        arcCount++;
+    }
+    static void removeArc(vector<Arc>& list, int node) {
+        for (size_t i = 0; i < list.size(); i++) {
+            if (list[i].node == node) {
+                list[i] = list.back();
+                list.pop_back();
+                return;
+            }
+        }
+    }
+};
+
+// Bounded Dijkstra used to look for witnesses, avoiding the airport being contracted.
+struct WitnessSearch {
+    vector<uint64_t> key;
+    vector<int> touched;
+    vector<pair<uint64_t, int>> heap;
+
+    // Function to search from source without passing skip, until maxKey or settleLimit settled airports.
+    void run(const ContractionGraph& cg, int source, int skip, uint64_t maxKey, int settleLimit) {
+        for (int v : touched) key[v] = INF_KEY;
+        touched.assign(1, source);
+        key[source] = 0;
+        heap.assign(1, { 0, source });
+        int settled = 0;
+        while (!heap.empty() && settled < settleLimit) {
+            pop_heap(heap.begin(), heap.end(), greater<pair<uint64_t, int>>());
+            auto [k, u] = heap.back();
+            heap.pop_back();
+            if (k != key[u]) continue; // Stale entry.
+            if (k > maxKey) break;
+            settled++;
+            for (const ContractionGraph::Arc& arc : cg.out[u]) {
+                if (arc.node == skip) continue;
+                uint64_t next = k + arc.weight;
+                if (next < key[arc.node]) {
+                    if (key[arc.node] == INF_KEY) touched.push_back(arc.node);
+                    key[arc.node] = next;
+                    heap.push_back({ next, arc.node });
+                    push_heap(heap.begin(), heap.end(), greater<pair<uint64_t, int>>());
+                }
+            }
+        }
+    }
+};
+
+// Function to list the shortcuts that contracting v needs, as (from, to, weight).
+void findShortcuts(const ContractionGraph& cg, int v, WitnessSearch& witness, vector<tuple<int, int, uint64_t>>& shortcuts) {
+    shortcuts.clear();
+    uint64_t maxOut = 0;
+    for (const ContractionGraph::Arc& arc : cg.out[v]) maxOut = max(maxOut, arc.weight);
+    for (const ContractionGraph::Arc& from : cg.in[v]) {
+        witness.run(cg, from.node, v, from.weight + maxOut, 64);
+        for (const ContractionGraph::Arc& to : cg.out[v]) {
+            if (to.node == from.node) continue;
+            uint64_t through = from.weight + to.weight;
+            if (witness.key[to.node] > through) shortcuts.push_back({ from.node, to.node, through });
+        }
+    }
+}
+
+// Function to build the contraction hierarchy of a route graph. Contraction stops, leaving a core,
+// when the remaining airports average more than coreDegree arcs each. 0 contracts everything, which
+// suits hub-and-spoke networks; a limit around 32 keeps preprocessing bounded on random networks
+// with no hub structure, at the price of slower queries through the core.
+ContractionHierarchy buildHierarchy(const RouteGraph& g, int coreDegree = 0) {
+    int n = g.airportCount;
+    ContractionGraph cg;
+    cg.out.resize(n);
+    cg.in.resize(n);
+    cg.contracted.assign(n, 0);
+    for (int u = 0; u < n; u++) {
+        for (int e = g.offset[u]; e < g.offset[u + 1]; e++) {
+            if (g.destination[e] != u) cg.addArc(u, g.destination[e], routeKey(g.distance[e], g.cost[e]), -1);
+        }
+    }
+
+    WitnessSearch witness;
+    witness.key.assign(n, INF_KEY);
+    vector<tuple<int, int, uint64_t>> shortcuts;
+    vector<int> deletedNeighbors(n, 0);
+    auto priority = [&](int v) {
+        findShortcuts(cg, v, witness, shortcuts);
+        return (int)shortcuts.size() - (int)(cg.in[v].size() + cg.out[v].size()) + deletedNeighbors[v];
+    };
+    vector<pair<int, int>> queue; // (priority, airport) min-heap, re-checked lazily.
+    for (int v = 0; v < n; v++) queue.push_back({ priority(v), v });
+    make_heap(queue.begin(), queue.end(), greater<pair<int, int>>());
+
+    ContractionHierarchy ch;
+    ch.airportCount = n;
+    ch.rank.assign(n, -1);
+    vector<vector<ContractionGraph::Arc>> up(n), down(n);
+    int remaining = n, nextRank = 0;
+    while (!queue.empty()) {
+        if (coreDegree > 0 && cg.arcCount > (long long)coreDegree * remaining) break;
+        pop_heap(queue.begin(), queue.end(), greater<pair<int, int>>());
+        int v = queue.back().second;
+        queue.pop_back();
+        int p = priority(v); // Leaves v's shortcuts in shortcuts.
+        if (!queue.empty() && p > queue.front().first) {
+            queue.push_back({ p, v });
+            push_heap(queue.begin(), queue.end(), greater<pair<int, int>>());
+            continue;
+        }
+
+        // Contract v: its remaining arcs become its hierarchy arcs, then the shortcuts replace it.
+        ch.rank[v] = nextRank++;
+        cg.contracted[v] = 1;
+        remaining--;
+        up[v] = cg.out[v];
+        down[v] = cg.in[v];
+        for (const ContractionGraph::Arc& arc : cg.out[v]) {
+            ContractionGraph::removeArc(cg.in[arc.node], v);
+            deletedNeighbors[arc.node]++;
+        }
+        for (const ContractionGraph::Arc& arc : cg.in[v]) {
+            ContractionGraph::removeArc(cg.out[arc.node], v);
+            deletedNeighbors[arc.node]++;
+        }
+        cg.arcCount -= cg.out[v].size() + cg.in[v].size();
+        cg.out[v].clear();
+        cg.in[v].clear();
+        for (const auto& [from, to, weight] : shortcuts) cg.addArc(from, to, weight, v);
+    }
+
+    // The core keeps every remaining arc in both directions.
+    for (int v = 0; v < n; v++) {
+        if (cg.contracted[v]) continue;
+        ch.rank[v] = nextRank++;
+        ch.coreSize++;
+        up[v] = cg.out[v];
+        down[v] = cg.in[v];
+    }
+
+    auto pack = [n](const vector<vector<ContractionGraph::Arc>>& lists, vector<int>& offset, vector<int>& node,
+        vector<int>& middle, vector<uint64_t>& weight) {
+        offset.assign(n + 1, 0);
+        for (int v = 0; v < n; v++) offset[v + 1] = offset[v] + (int)lists[v].size();
+        for (int v = 0; v < n; v++) {
+            for (const ContractionGraph::Arc& arc : lists[v]) {
+                node.push_back(arc.node);
+                middle.push_back(arc.middle);
+                weight.push_back(arc.weight);
+            }
+        }
+    };
+    pack(up, ch.upOffset, ch.upTarget, ch.upMiddle, ch.upWeight);
+    pack(down, ch.downOffset, ch.downSource, ch.downMiddle, ch.downWeight);
+    ch.fingerprint = graphFingerprint(g);
+    return ch;
+}
+
+// Search arrays reused between hierarchy queries.
+struct HierarchyScratch {
+    vector<uint64_t> key[2];   // Forward and backward labels.
+    vector<int> parent[2];     // Arc index that reached each airport in that direction, or -1.
+    vector<int> touched[2];
+    vector<pair<uint64_t, int>> heap[2];
+    vector<pair<int, int>> arcs; // (from, arc index) on the forward half of the last route.
+
+    void prepare(int n) {
+        for (int side = 0; side < 2; side++) {
+            if ((int)key[side].size() != n) {
+                key[side].assign(n, INF_KEY);
+                parent[side].assign(n, -1);
+                touched[side].clear();
+            }
+            for (int v : touched[side]) {
+                key[side][v] = INF_KEY;
+                parent[side][v] = -1;
+            }
+            touched[side].clear();
+            heap[side].clear();
+        }
+    }
+};
+
+// Function to find the index of arc from -> to among v's upward (to) or downward (from) arcs.
+int hierarchyArc(const ContractionHierarchy& ch, bool upward, int v, int other) {
+    if (upward) {
+        for (int e = ch.upOffset[v]; e < ch.upOffset[v + 1]; e++) {
+            if (ch.upTarget[e] == other) return e;
+        }
+    }
+    else {
+        for (int e = ch.downOffset[v]; e < ch.downOffset[v + 1]; e++) {
+            if (ch.downSource[e] == other) return e;
+        }
+    }
+    return -1;
+}
+
+// Function to append the airports of arc from -> to (skipping from) with shortcuts expanded.
+void unpackArc(const ContractionHierarchy& ch, int from, int to, int middle, vector<int>& path) {
+    vector<tuple<int, int, int>> stack = { { from, to, middle } };
+    while (!stack.empty()) {
+        auto [a, b, m] = stack.back();
+        stack.pop_back();
+        if (m == -1) {
+            path.push_back(b);
+            continue;
+        }
+        // a -> m is one of m's downward arcs and m -> b one of its upward arcs; expand a -> m first.
+        int second = hierarchyArc(ch, true, m, b), first = hierarchyArc(ch, false, m, a);
+        stack.push_back({ m, b, ch.upMiddle[second] });
+        stack.push_back({ a, m, ch.downMiddle[first] });
+    }
+}
+
+// Function to check whether a settled airport can be skipped ("stall on demand"): if a more important
+// airport already reached by this side has an arc into u that gives a shorter label, u's label is not
+// a shortest route and relaxing its arcs cannot help.
+bool stalled(const ContractionHierarchy& ch, int side, int u, uint64_t k, const HierarchyScratch& s) {
+    const vector<uint64_t>& key = s.key[side];
+    if (side == 0) {
+        for (int e = ch.downOffset[u]; e < ch.downOffset[u + 1]; e++) {
+            uint64_t via = key[ch.downSource[e]];
+            if (via != INF_KEY && via + ch.downWeight[e] < k) return true;
+        }
+    }
+    else {
+        for (int e = ch.upOffset[u]; e < ch.upOffset[u + 1]; e++) {
+            uint64_t via = key[ch.upTarget[e]];
+            if (via != INF_KEY && via + ch.upWeight[e] < k) return true;
+        }
+    }
+    return false;
+}
+
+// Function to find the shortest route with a bidirectional upward search. Each side stops once its
+// smallest label reaches the best route found, which is exact because every shortest route climbs
+// to a top airport (or through the core) that both sides settle. The unpacked route goes to path.
+RouteResult hierarchyRoute(const ContractionHierarchy& ch, int origin, int target, HierarchyScratch& s, vector<int>& path) {
+    ROUTE_STATS_SCOPE(StatsQuery::Hierarchy);
+    RouteResult route;
+    path.clear();
+    s.prepare(ch.airportCount);
+    uint64_t best = INF_KEY;
+    int meet = -1;
+    for (int side = 0; side < 2; side++) {
+        int start = side == 0 ? origin : target;
+        s.key[side][start] = 0;
+        s.touched[side].push_back(start);
+        s.heap[side].push_back({ 0, start });
+    }
+    if (origin == target) {
+        best = 0;
+        meet = origin;
+    }
+    int side = 0;
+    while (true) {
+        bool open[2];
+        for (int k = 0; k < 2; k++) open[k] = !s.heap[k].empty() && s.heap[k].front().first < best;
+        if (!open[0] && !open[1]) break;
+        if (!open[side]) side ^= 1;
+
+        auto& heap = s.heap[side];
+        pop_heap(heap.begin(), heap.end(), greater<pair<uint64_t, int>>());
+        auto [k, u] = heap.back();
+        heap.pop_back();
+        ROUTE_STAT(STAT_HEAP_OPS, 1);
+        if (k != s.key[side][u]) continue; // Stale entry.
+        ROUTE_STAT(STAT_SETTLED, 1);
+        uint64_t other = s.key[side ^ 1][u];
+        if (other != INF_KEY && k + other < best) {
+            best = k + other;
+            meet = u;
+        }
+        if (stalled(ch, side, u, k, s)) continue;
+        int first = side == 0 ? ch.upOffset[u] : ch.downOffset[u];
+        int last = side == 0 ? ch.upOffset[u + 1] : ch.downOffset[u + 1];
+        ROUTE_STAT(STAT_RELAXED, last - first);
+        for (int e = first; e < last; e++) {
+            int v = side == 0 ? ch.upTarget[e] : ch.downSource[e];
+            uint64_t next = k + (side == 0 ? ch.upWeight[e] : ch.downWeight[e]);
+            if (next < s.key[side][v]) {
+                if (s.key[side][v] == INF_KEY) s.touched[side].push_back(v);
+                s.key[side][v] = next;
+                s.parent[side][v] = e;
+                heap.push_back({ next, v });
+                push_heap(heap.begin(), heap.end(), greater<pair<uint64_t, int>>());
+                ROUTE_STAT(STAT_HEAP_OPS, 1);
+            }
+        }
+        side ^= 1; // Alternate sides.
+    }
+    if (meet == -1) return route;
+
+    route.found = true;
+    route.distance = keyDistance(best);
+    route.cost = keyCost(best);
+    // Forward half: walk the parent arcs back from meet, then expand them front to back.
+    vector<pair<int, int>>& arcs = s.arcs;
+    arcs.clear();
+    for (int v = meet; v != origin;) {
+        int e = s.parent[0][v];
+        int from = int(upper_bound(ch.upOffset.begin(), ch.upOffset.end(), e) - ch.upOffset.begin()) - 1;
+        arcs.push_back({ from, e });
+        v = from;
+    }
+    path.push_back(origin);
+    for (auto it = arcs.rbegin(); it != arcs.rend(); ++it) unpackArc(ch, it->first, ch.upTarget[it->second], ch.upMiddle[it->second], path);
+    // Backward half: arcs lead from meet towards the target.
+    for (int v = meet; v != target;) {
+        int e = s.parent[1][v];
+        int to = int(upper_bound(ch.downOffset.begin(), ch.downOffset.end(), e) - ch.downOffset.begin()) - 1;
+        unpackArc(ch, v, to, ch.downMiddle[e], path);
+        v = to;
+    }
+    return route;
+}
+
+// Hierarchy file: a header like the snapshot's, then rank[V], the upward arrays (offset, target,
+// middle, weight) and the downward arrays, each section padded to 8 bytes.
+const char HIERARCHY_MAGIC[8] = { 'G', '5', 'H', 'I', 'E', 'R', 'A', 'R' };
+const uint32_t HIERARCHY_VERSION = 1;
+
+struct HierarchyHeader {
+    char magic[8];           // HIERARCHY_MAGIC.
+    uint32_t version;        // HIERARCHY_VERSION.
+    uint32_t byteOrder;      // SNAPSHOT_BYTE_ORDER as written.
+    uint64_t headerSize;     // sizeof(HierarchyHeader) when written.
+    uint64_t airportCount;   // V.
+    uint64_t upCount;        // Upward arcs.
+    uint64_t downCount;      // Downward arcs.
+    uint64_t coreSize;       // Uncontracted airports.
+    uint64_t fingerprint;    // graphFingerprint() of the graph.
+    uint64_t checksum;       // SnapshotChecksum of the sections.
+};
+
+// Function to write a hierarchy next to its graph. Returns false if the file cannot be written.
+bool writeHierarchy(const ContractionHierarchy& ch, const string& filename) {
+    ofstream out(filename, ios::binary | ios::trunc);
+    if (!out) return false;
+    HierarchyHeader header = {};
+    memcpy(header.magic, HIERARCHY_MAGIC, 8);
+    header.version = HIERARCHY_VERSION;
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.headerSize = sizeof(HierarchyHeader);
+    header.airportCount = ch.airportCount;
+    header.upCount = ch.upTarget.size();
+    header.downCount = ch.downSource.size();
+    header.coreSize = ch.coreSize;
+    header.fingerprint = ch.fingerprint;
+    out.write((const char*)&header, sizeof(header)); // Rewritten with the checksum at the end.
+
+    SnapshotChecksum checksum;
+    writeSnapshotSection(out, checksum, ch.rank.data(), ch.rank.size() * sizeof(int));
+    writeSnapshotSection(out, checksum, ch.upOffset.data(), ch.upOffset.size() * sizeof(int));
+    writeSnapshotSection(out, checksum, ch.upTarget.data(), ch.upTarget.size() * sizeof(int));
+    writeSnapshotSection(out, checksum, ch.upMiddle.data(), ch.upMiddle.size() * sizeof(int));
+    writeSnapshotSection(out, checksum, ch.upWeight.data(), ch.upWeight.size() * sizeof(uint64_t));
+    writeSnapshotSection(out, checksum, ch.downOffset.data(), ch.downOffset.size() * sizeof(int));
+    writeSnapshotSection(out, checksum, ch.downSource.data(), ch.downSource.size() * sizeof(int));
+    writeSnapshotSection(out, checksum, ch.downMiddle.data(), ch.downMiddle.size() * sizeof(int));
+    writeSnapshotSection(out, checksum, ch.downWeight.data(), ch.downWeight.size() * sizeof(uint64_t));
+
+    header.checksum = checksum.value;
+    out.seekp(0);
+    out.write((const char*)&header, sizeof(header));
+    return (bool)out;
+}
+
+// Function to load a hierarchy for graph g. Returns false, after reporting why, if the file is
+// missing, invalid, or was built for a different graph.
+bool loadHierarchy(const string& filename, const RouteGraph& g, ContractionHierarchy& ch) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        cerr << "Cannot open " << filename << endl;
+        return false;
+    }
+    HierarchyHeader header;
+    if (file.size < sizeof(header)) {
+        cerr << filename << ": not a route hierarchy" << endl;
+        return false;
+    }
+    memcpy(&header, file.data, sizeof(header));
+    if (memcmp(header.magic, HIERARCHY_MAGIC, 8) != 0 || header.headerSize != sizeof(header)) {
+        cerr << filename << ": not a route hierarchy" << endl;
+        return false;
+    }
+    if (header.version != HIERARCHY_VERSION || header.byteOrder != SNAPSHOT_BYTE_ORDER) {
+        cerr << filename << ": unsupported hierarchy version or byte order" << endl;
+        return false;
+    }
+    if (header.airportCount != (uint64_t)g.airportCount || header.fingerprint != graphFingerprint(g)) {
+        cerr << filename << ": hierarchy was built for a different route graph" << endl;
+        return false;
+    }
+
+    uint64_t v = header.airportCount, up = header.upCount, down = header.downCount;
+    size_t expected = sizeof(header) + snapshotPadded(v * sizeof(int)) + 2 * snapshotPadded((v + 1) * sizeof(int))
+        + 2 * snapshotPadded(up * sizeof(int)) + up * sizeof(uint64_t) + 2 * snapshotPadded(down * sizeof(int))
+        + down * sizeof(uint64_t);
+    if (up > (uint64_t)INT32_MAX || down > (uint64_t)INT32_MAX || expected != file.size) {
+        cerr << filename << ": truncated or corrupt hierarchy" << endl;
+        return false;
+    }
+    SnapshotChecksum checksum;
+    checksum.add(file.data + sizeof(header), file.size - sizeof(header));
+    if (checksum.value != header.checksum) {
+        cerr << filename << ": hierarchy checksum mismatch" << endl;
+        return false;
+    }
+
+    const char* cursor = file.data + sizeof(header);
+    auto take = [&](auto& target, size_t count) {
+        using T = typename remove_reference<decltype(target)>::type::value_type;
+        const T* first = (const T*)cursor;
+        target.assign(first, first + count);
+        cursor += snapshotPadded(count * sizeof(T));
+    };
+    ch = ContractionHierarchy();
+    ch.airportCount = (int)v;
+    ch.coreSize = (int)header.coreSize;
+    ch.fingerprint = header.fingerprint;
+    take(ch.rank, v);
+    take(ch.upOffset, v + 1);
+    take(ch.upTarget, up);
+    take(ch.upMiddle, up);
+    take(ch.upWeight, up);
+    take(ch.downOffset, v + 1);
+    take(ch.downSource, down);
+    take(ch.downMiddle, down);
+    take(ch.downWeight, down);
+    if (ch.upOffset[v] != (int)up || ch.downOffset[v] != (int)down) {
+        cerr << filename << ": inconsistent hierarchy sections" << endl;
+        ch = ContractionHierarchy();
+        return false;
+    }
+    return true;
+}
+
+ContractionHierarchy routeHierarchy; // Hierarchy of routeGraph loaded with --hierarchy; empty (no airports) without one.
+
+//==================== TIMETABLE ====================//
+// Scheduled flights for earliest-arrival queries. A schedule is the route CSV with extra columns:
+//   Origin_airport,Destination_airport,Origin_city,Destination_city,Distance,Cost,Departure,Arrival[,Min_connection]
+// Each row is one daily flight. Times are "HH:MM" (local to one clock); an arrival earlier than its
+// departure lands the next day. Min_connection is the minimum connection time at the origin airport,
+// in minutes; an airport takes the largest value given on any of its rows (default 0). The first six
+// columns are the static schema, so readCSV loads a schedule as a plain route graph (one leg per
+// flight) and the static tasks run on it unchanged.
+// The flights are kept as connection arrays sorted by departure, and queries use the Connection Scan
+// Algorithm: one pass over the flights departing after the requested time, stopped as soon as no
+// flight can still improve the arrival at the target. A schedule covers one day and is not repeated,
+// so journeys must depart the same day.
+
+// Sorted connection arrays. Airports share the indices of the route graph loaded with them.
+struct Timetable {
+    int airportCount = 0;
+    vector<int> departure;     // Departure of each flight, minutes after midnight, ascending.
+    vector<int> arrival;       // Arrival of each flight, minutes after the same midnight.
+    vector<int> from, to;      // Origin and destination airport of each flight.
+    vector<int> cost;          // Fare of each flight.
+    vector<int> minConnection; // Minimum connection time of each airport, in minutes.
+
+    int flightCount() const { return (int)departure.size(); }
+};
+
+// Function to parse "HH:MM" (hours may exceed 23) into minutes. Returns false if malformed.
+bool parseClock(string_view text, int& minutes) {
+    size_t colon = text.find(':');
+    int hours, mins;
+    if (colon == string_view::npos || !parseInt(text.substr(0, colon), hours) || !parseInt(text.substr(colon + 1), mins)
+        || hours < 0 || mins < 0 || mins > 59) return false;
+    minutes = hours * 60 + mins;
+    return true;
+}
+
+// Function to format minutes after midnight as "HH:MM", with "+1" (and so on) for later days.
+string formatClock(int minutes) {
+    string text(5, '0');
+    int clock = minutes % 1440;
+    text[0] = (char)('0' + clock / 600);
+    text[1] = (char)('0' + clock / 60 % 10);
+    text[2] = ':';
+    text[3] = (char)('0' + clock % 60 / 10);
+    text[4] = (char)('0' + clock % 10);
+    if (minutes >= 1440) text += "+" + to_string(minutes / 1440);
+    return text;
+}
+
+// One flight read from a schedule, before sorting.
+struct ScheduledFlight {
+    int departure, arrival, from, to, cost;
+};
+
+// Function to sort flights into a timetable's connection arrays (by departure, then arrival).
+void buildTimetable(vector<ScheduledFlight>& flights, const vector<int>& minConnection, Timetable& timetable) {
+    sort(flights.begin(), flights.end(), [](const ScheduledFlight& a, const ScheduledFlight& b) {
+        return a.departure != b.departure ? a.departure < b.departure : a.arrival < b.arrival;
+    });
+    timetable = Timetable();
+    timetable.airportCount = (int)minConnection.size();
+    timetable.minConnection = minConnection;
+    for (const ScheduledFlight& f : flights) {
+        timetable.departure.push_back(f.departure);
+        timetable.arrival.push_back(f.arrival);
+        timetable.from.push_back(f.from);
+        timetable.to.push_back(f.to);
+        timetable.cost.push_back(f.cost);
+    }
+}
+
+// Function to load a schedule CSV into a route graph (every row) and a timetable (rows with valid
+// times). Rows without time columns are static legs only; rows with bad times are reported and kept
+// as static legs.
+bool loadSchedule(const MappedFile& file, const string& filename, RouteGraph& graph, Timetable& timetable) {
+    RouteGraphBuilder builder;
+    vector<ScheduledFlight> flights;
+    vector<int> minConnection;
+    bool header = true;
+    parseCsvRange(file.data, file.data + file.size, 1, filename, cerr, [&](const CsvRow& row, int lineNumber) {
+        if (header) {
+            header = false;
+            return;
+        }
+        if (!addCsvRow(builder, row, lineNumber, filename, cerr) || row.count < 8) return;
+        const RouteLeg& leg = builder.legs.back();
+        ScheduledFlight flight{ 0, 0, leg.origin, leg.destination, leg.cost };
+        int connection = 0;
+        if (!parseClock(row.field[6], flight.departure) || !parseClock(row.field[7], flight.arrival)
+            || (row.count > 8 && !row.field[8].empty() && (!parseInt(row.field[8], connection) || connection < 0))) {
+            cerr << filename << ":" << lineNumber << ": invalid departure, arrival or connection time, flight skipped" << endl;
+            return;
+        }
+        if (flight.arrival < flight.departure) flight.arrival += 1440; // Lands the next day.
+        if ((int)minConnection.size() < (int)builder.code.size()) minConnection.resize(builder.code.size(), 0);
+        minConnection[leg.origin] = max(minConnection[leg.origin], connection);
+        flights.push_back(flight);
+    });
+    graph = builder.finalize();
+    minConnection.resize(graph.airportCount, 0);
+    buildTimetable(flights, minConnection, timetable);
+    return true;
+}
+
+// Function to write a route graph and its timetable as a schedule CSV, one row per flight.
+// Returns false on a write error.
+bool writeScheduleCSV(const RouteGraph& g, const Timetable& timetable, const string& filename) {
+    ofstream file(filename, ios::binary);
+    if (!file) return false;
+    file << "Origin_airport,Destination_airport,Origin_city,Destination_city,Distance,Cost,Departure,Arrival,Min_connection\n";
+    string line;
+    for (int c = 0; c < timetable.flightCount(); c++) {
+        int u = timetable.from[c], v = timetable.to[c];
+        int distance = 0; // Distance of the matching leg in the graph.
+        for (int e = g.offset[u]; e < g.offset[u + 1]; e++) {
+            if (g.destination[e] == v) {
+                distance = g.distance[e];
+                break;
+            }
+        }
+        line.clear();
+        appendCsvField(line, g.code[u]);
+        line += ',';
+        appendCsvField(line, g.code[v]);
+        line += ',';
+        appendCsvField(line, g.city[u]);
+        line += ',';
+        appendCsvField(line, g.city[v]);
+        line += ',' + to_string(distance) + ',' + to_string(timetable.cost[c]) + ',';
+        line += formatClock(timetable.departure[c]).substr(0, 5) + ',' + formatClock(timetable.arrival[c] % 1440).substr(0, 5);
+        line += ',' + to_string(timetable.minConnection[u]) + '\n';
+        file << line;
+    }
+    return (bool)file;
+}
+
+// Outcome of an earliest-arrival query. The flights taken go to a caller-provided buffer.
+struct JourneyResult {
+    bool found = false;
+    int departure = 0; // Departure of the first flight, minutes after midnight.
+    int arrival = 0;   // Arrival at the target, minutes after the same midnight.
+};
+
+// Per-query arrays, reset only where the last query wrote.
+struct TimetableScratch {
+    vector<int> arrivalAt;   // Earliest arrival at each airport, INF if not reached.
+    vector<int> inFlight;    // Flight that gave that arrival, or -1.
+    vector<int> touched;
+
+    void prepare(int n) {
+        if ((int)arrivalAt.size() != n) {
+            arrivalAt.assign(n, INF);
+            inFlight.assign(n, -1);
+            touched.clear();
+        }
+        for (int v : touched) {
+            arrivalAt[v] = INF;
+            inFlight[v] = -1;
+        }
+        touched.clear();
+    }
+};
+
+// Function to find the earliest arrival at target when leaving origin no earlier than departAfter
+// (minutes after midnight). Connections after the first flight must respect the minimum connection
+// time of the airport. The flights taken, in order, go to flights (cleared when there is no journey).
+JourneyResult earliestArrival(const Timetable& tt, int origin, int target, int departAfter, TimetableScratch& s,
+    vector<int>& flights) {
+    ROUTE_STATS_SCOPE(StatsQuery::Timetable);
+    JourneyResult journey;
+    flights.clear();
+    s.prepare(tt.airportCount);
+    s.arrivalAt[origin] = departAfter;
+    s.touched.push_back(origin);
+    if (origin == target) return { true, departAfter, departAfter };
+
+    int first = int(lower_bound(tt.departure.begin(), tt.departure.end(), departAfter) - tt.departure.begin());
+    for (int c = first; c < tt.flightCount(); c++) {
+        int dep = tt.departure[c];
+        if (dep >= s.arrivalAt[target]) break; // No later flight can arrive earlier.
+        ROUTE_STAT(STAT_RELAXED, 1);
+        int u = tt.from[c];
+        int ready = s.arrivalAt[u];
+        if (ready == INF) continue;
+        if (u != origin) ready += tt.minConnection[u];
+        int v = tt.to[c];
+        if (dep < ready || tt.arrival[c] >= s.arrivalAt[v]) continue;
+        if (s.arrivalAt[v] == INF) s.touched.push_back(v);
+        s.arrivalAt[v] = tt.arrival[c];
+        s.inFlight[v] = c;
+        ROUTE_STAT(STAT_SETTLED, 1);
+    }
+    if (s.inFlight[target] == -1) return journey;
+
+    for (int v = target; v != origin && (int)flights.size() <= tt.airportCount; v = tt.from[s.inFlight[v]]) {
+        flights.push_back(s.inFlight[v]);
+    }
+    reverse(flights.begin(), flights.end());
+    journey = { true, tt.departure[flights.front()], s.arrivalAt[target] };
+    return journey;
+}
+
+//==================== ROUTE FORMATTING ====================//
+// Text output for query results. The engines above only fill result structs and path buffers;
+// the task functions below pass those here to print them, and other callers can skip this layer.
+
+// Function to write the airport codes of a route, joined by separator.
+void writePath(ostream& out, const RouteGraph& g, const int* path, int length, const char* separator) {
+    for (int i = 0; i < length; i++) {
+        if (i) out << separator;
+        out << g.code[path[i]];
+    }
+}
+
+// Function to write a route as "A -> B. The length is D. The cost is $C." (no line break).
+void writeRoute(ostream& out, const RouteGraph& g, const RouteResult& route, const int* path, int length,
+    const char* separator) {
+    writePath(out, g, path, length, separator);
+    out << ". The length is " << route.distance << ". The cost is $" << route.cost << ".";
+}
+
+// Function to write a route as one row of a Path / Length / Cost table.
+void writeRouteRow(ostream& out, const RouteGraph& g, const RouteResult& route, const int* path, int length) {
+    string pathstr;
+    for (int i = 0; i < length; i++) {
+        if (i) pathstr += "->";
+        pathstr += g.code[path[i]];
+    }
+    out << left << setw(30) << pathstr << setw(10) << route.distance << setw(10) << route.cost << endl;
+}
+
+//==================== TASK 2 ====================//
+// Dijkstra's algorithm for shortest path (minimizing distance)
+void findShortestPath(const string& originCode, const string& destCode) {
+    const RouteGraph& g = routeGraph;  // Shorthand for the route graph.
+    int origin = g.findAirport(originCode);        // Index of the origin airport (-1 if unknown).
+    int destination = g.findAirport(destCode);     // Index of the destination airport (-1 if unknown).
+
+    // If either the origin or destination airport is not found, print "None".
+    if (origin == -1 || destination == -1) {
+        cout << "Shortest route from " << originCode << " to " << destCode << ": None" << endl;
+        return;
+    }
+
+    static DijkstraScratch scratch;          // Search arrays reused across calls.
+    static HierarchyScratch hierarchyScratch; // The same, for hierarchy queries.
+    static vector<int> path;                 // Airports on the route, origin first.
+    RouteResult route;                       // Stays not found if the pair is known to be unreachable.
+    if (connectivity.reachable(origin, destination) != Reachability::No) {
+        if (routeHierarchy.airportCount > 0) route = hierarchyRoute(routeHierarchy, origin, destination, hierarchyScratch, path);
+        else route = shortestRoute(g, origin, destination, defaultHeap, scratch, path);
+    }
+
+    // If the destination is not reachable, print "None".
+    if (!route.found) {
+        cout << "Shortest route from " << originCode << " to " << destCode << ": None" << endl;
+        return;
+    }
+
+    // Print the shortest path, its length, and its cost.
+    cout << "Shortest route from " << originCode << " to " << destCode << ": ";
+    writeRoute(cout, g, route, path.data(), (int)path.size(), " -> ");
+    cout << endl;
+}
+
+// Function to print every Pareto-optimal route between two airports, from shortest to cheapest.
+void findRouteTradeoffs(const string& originCode, const string& destCode) {
+    const RouteGraph& g = routeGraph;
+    int origin = g.findAirport(originCode);
+    int destination = g.findAirport(destCode);
+    static ParetoScratch scratch; // Search arrays reused across calls.
+    ParetoResult result;
+    if (origin != -1 && destination != -1 && connectivity.reachable(origin, destination) != Reachability::No)
+        result = paretoRoutes(g, reverseRoutes, origin, destination, scratch);
+    if (result.routes.empty()) {
+        cout << "Route trade-offs from " << originCode << " to " << destCode << ": None" << endl;
+        return;
+    }
+    cout << "Route trade-offs from " << originCode << " to " << destCode << ":" << endl;
+    for (const ParetoRoute& route : result.routes) {
+        cout << "  ";
+        writeRoute(cout, g, { true, route.distance, route.cost }, route.path.data(), (int)route.path.size(), " -> ");
+        cout << endl;
+    }
+    if (result.truncated) cout << "  (label limit reached; more trade-offs may exist)" << endl;
+}
+
+// Function to print up to k alternative loopless routes between two airports, best first.
+void findAlternativeRoutes(const string& originCode, const string& destCode, int k, RouteRank rank = RouteRank::Distance) {
+    const RouteGraph& g = routeGraph;
+    int origin = g.findAirport(originCode);
+    int destination = g.findAirport(destCode);
+    static KShortestScratch scratch; // Search arrays reused across calls.
+    static RouteSet routes;          // Results and path buffer reused across calls.
+    routes.routes.clear();
+    if (origin != -1 && destination != -1 && connectivity.reachable(origin, destination) != Reachability::No)
+        kShortestRoutes(g, reverseRoutes, origin, destination, k, rank, scratch, routes);
+    if (routes.routes.empty()) {
+        cout << "Alternative routes from " << originCode << " to " << destCode << ": None" << endl;
+        return;
+    }
+    cout << "Alternative routes from " << originCode << " to " << destCode << " by "
+        << (rank == RouteRank::Distance ? "distance" : "cost") << ":" << endl;
+    for (int i = 0; i < routes.size(); i++) {
+        cout << "  " << i + 1 << ". ";
+        writeRoute(cout, g, routes.routes[i], routes.path(i), routes.pathLength(i), " -> ");
+        cout << endl;
+    }
+}
+
+// Function to print the journey that arrives earliest at destCode when leaving originCode no earlier
+// than departAfter ("HH:MM"), one flight per line.
+void findEarliestArrival(const RouteGraph& g, const Timetable& timetable, const string& originCode,
+    const string& destCode, const string& departAfter) {
+    int origin = g.findAirport(originCode);
+    int destination = g.findAirport(destCode);
+    int start = 0;
+    static TimetableScratch scratch; // Search arrays reused across calls.
+    static vector<int> flights;      // Flights of the journey, in order.
+    JourneyResult journey;
+    if (origin != -1 && destination != -1 && parseClock(departAfter, start)) {
+        journey = earliestArrival(timetable, origin, destination, start, scratch, flights);
+    }
+    if (!journey.found) {
+        cout << "Earliest arrival from " << originCode << " to " << destCode << " after " << departAfter << ": None" << endl;
+        return;
+    }
+    cout << "Earliest arrival from " << originCode << " to " << destCode << " after " << departAfter << ": "
+        << formatClock(journey.arrival) << " (" << flights.size() << " flights)" << endl;
+    for (int c : flights) {
+        cout << "  " << g.code[timetable.from[c]] << " " << formatClock(timetable.departure[c]) << " -> "
+            << g.code[timetable.to[c]] << " " << formatClock(timetable.arrival[c]) << " ($" << timetable.cost[c] << ")" << endl;
+    }
+}
+
+//==================== TASK 3 ====================//
+// Find all shortest paths from origin to all airports in a specific state (city substring)
+
+// Function to print the shortest route from the origin to every airport in a destination set.
+void printRoutesToAirports(const string& originCode, const vector<int>& destination) {
+    const RouteGraph& g = routeGraph;
+    int origin = g.findAirport(originCode); // Integer to store the index of the origin airport.
+    if (origin == -1) {
+        cout << "Shortest route from " << originCode << ": None" << endl;
+        return;
+    }
+
+    // One search from the origin settles every destination airport. Airports the connectivity index
+    // rules out are left out of it, so the search can stop as soon as the reachable ones are settled.
+    static DijkstraScratch scratch; // Search arrays reused across calls.
+    static RouteSet routes;         // Results and path buffer reused across calls.
+    static vector<int> targets;     // Destination airports that may be reachable.
+    targets.clear();
+    for (int v : destination) {
+        if (connectivity.reachable(origin, v) != Reachability::No) targets.push_back(v);
+    }
+    shortestRoutesToMany(g, origin, targets, defaultHeap, scratch, routes);
+
+    int next = 0; // Result of the next searched airport.
+    for (int v : destination) {
+        // If the destination airport is not reachable, print "None".
+        int i = connectivity.reachable(origin, v) != Reachability::No ? next++ : -1;
+        if (i == -1 || !routes.routes[i].found) {
+            cout << "Shortest route from " << originCode << " to " << g.code[v] << ": None" << endl;
+            continue;
+        }
+        // Print the shortest path, its length, and its cost.
+        writeRouteRow(cout, g, routes.routes[i], routes.path(i), routes.pathLength(i));
+    }
+}
+
+void usingState(const string& originCode, const string& destCity) {
+    string destState = destCity.substr(destCity.length() - 2, 2); // Extract the state abbreviation (last two characters of destCity).
+    cout << "\nShortest route from " << originCode << " to " << destState << " state airports are: " << endl;
+    cout << "\n" << left << setw(30) << "Path" << setw(10) << "Length" << setw(10) << "Cost" << endl;
+
+    // The airports of each state are indexed at load time.
+    int state = regionIndex.findState(destState);
+    static const vector<int> none;
+    printRoutesToAirports(originCode, state == -1 ? none : regionIndex.stateAirports[state]);
+}
+
+// Find all shortest paths from origin to all airports in a named region (see regions.txt)
+void usingRegion(const string& originCode, const string& regionName) {
+    cout << "\nShortest route from " << originCode << " to " << regionName << " region airports are: " << endl;
+    int region = regionIndex.findRegion(regionName);
+    if (region == -1) {
+        cout << "Unknown region: " << regionName << endl;
+        return;
+    }
+    cout << "\n" << left << setw(30) << "Path" << setw(10) << "Length" << setw(10) << "Cost" << endl;
+    printRoutesToAirports(originCode, regionIndex.regionAirports[region]);
+}
+//==================== TASK 4 ====================//
+// Find shortest path with exact number of stops
+
+// Exhaustive search over every simple path with the required number of legs (exponential in
+// the stop count). Kept as the reference for the layered engine below and for benchmarks.
+void dfs(const RouteGraph& g, int current, int destination, int stopsLeft, int distanceSoFar,
+    int costSoFar, int& distance, int& cost, vector<bool>& visited, vector<int>& path,
+    vector<int>& bestPath) {
+    ROUTE_STATS_SCOPE(StatsQuery::Dfs);
+    ROUTE_STAT(STAT_DFS_NODES, 1);
+    // If the number of stops left is negative, return (backtrack).
+    if (stopsLeft < 0) return;
+
+    visited[current] = true;     // Mark the current airport as visited.
+    path.push_back(current);      // Add the current airport to the current path.
+
+    // If the destination is reached and the required number of stops is met.
+    if (current == destination && stopsLeft == 0) {
+        // If the current path is shorter than the best path found so far.
+        if (distanceSoFar < distance) {
+            distance = distanceSoFar; // Update the shortest distance.
+            cost = costSoFar;         // Update the corresponding cost.
+            bestPath = path;          // Update the best path.
+        }
+    }
+    else {
+        // Explore all neighbors of the current airport.
+        for (int e = g.offset[current]; e < g.offset[current + 1]; e++) {
+            int next = g.destination[e]; // Get the destination airport of the edge.
+            // If the neighbor has not been visited, recursively call dfs.
+            if (!visited[next]) {
+                dfs(g, next, destination, stopsLeft - 1, distanceSoFar + g.distance[e], costSoFar + g.cost[e], distance, cost, visited, path, bestPath);
+            }
+        }
+    }
+
+    path.pop_back();       // Remove the current airport from the path (backtrack).
+    visited[current] = false; // Mark the current airport as unvisited.
+}
+
+// Whether the stop count must be matched exactly or is only an upper bound.
+enum class StopsMode { Exact, AtMost };
+
+// Most routes the exact simple-route search of shortestWithStops() extends before it gives up.
+const int SIMPLE_ROUTE_BUDGET = 1 << 16;
+
+// Per-search state for the layered search; layer h holds the best label of every airport
+// reached with exactly h legs. Only touched entries are reset, so reuse across queries is cheap.
+struct StopsScratch {
+    vector<uint64_t> label;        // (layers x airports) best packed (distance, cost) label.
+    vector<int> parent;            // (layers x airports) airport in the previous layer, or -1.
+    vector<vector<int>> frontier;  // Airports reached in each layer.
+    vector<uint64_t> bound;        // (layers x airports) lower bound to the destination with r legs left.
+    vector<char> onRoute;          // Airports on the route being extended by the exact search.
+    vector<int> trail, bestTrail;  // Route being extended, and the best one found, origin first.
+    vector<pair<size_t, uint64_t>> rejected; // (layer * airports + airport, label) turned away as not simple.
+    int expanded = 0;              // Routes extended by the exact search so far.
+    bool capped = false;           // Whether the last search ran out of SIMPLE_ROUTE_BUDGET.
+
+    // Function to size the arrays for a search with the given number of layers.
+    void prepare(int layers, int airportCount) {
+        size_t needed = (size_t)layers * airportCount;
+        if (label.size() < needed) {
+            label.resize(needed, INF_KEY);
+            parent.resize(needed, -1);
+        }
+        if ((int)frontier.size() < layers) frontier.resize(layers);
+    }
+
+    // Function to clear every entry written by the last search.
+    void reset(int airportCount) {
+        for (int h = 0; h < (int)frontier.size(); h++) {
+            for (int v : frontier[h]) {
+                label[(size_t)h * airportCount + v] = INF_KEY;
+                parent[(size_t)h * airportCount + v] = -1;
+            }
+            frontier[h].clear();
+        }
+    }
+};
+
+// Function to check whether airport v already lies on the best route to (u, layer h).
+bool onLayeredPath(const StopsScratch& s, int airportCount, int u, int h, int v) {
+    for (; h >= 0; h--) {
+        if (u == v) return true;
+        u = s.parent[(size_t)h * airportCount + u];
+    }
+    return false;
+}
+
+// Function to extend the route in s.trail (ending at u after h legs, with label key) depth first, for
+// the exact simple-route search of shortestWithStops(). Routes have exactly legs legs (at most, with
+// exact unset). A branch is cut as soon as its label plus the lower bound for the legs left cannot
+// beat bestKey. Stops early, setting s.capped, once SIMPLE_ROUTE_BUDGET routes have been extended.
+void extendSimpleRoute(const RouteGraph& g, int u, int h, uint64_t key, int destination, int legs, bool exact,
+    StopsScratch& s, uint64_t& bestKey) {
+    ROUTE_STAT(STAT_DFS_NODES, 1);
+    if (++s.expanded > SIMPLE_ROUTE_BUDGET) {
+        s.capped = true;
+        return;
+    }
+    int n = g.airportCount;
+    if (u == destination && h > 0) { // A route ends at the destination.
+        if (key < bestKey && (!exact || h == legs)) {
+            bestKey = key;
+            s.bestTrail = s.trail;
+        }
+        return;
+    }
+    if (h == legs) return;
+    for (int e = g.offset[u]; e < g.offset[u + 1]; e++) {
+        int v = g.destination[e];
+        uint64_t bound = s.bound[(size_t)(legs - h - 1) * n + v];
+        if (s.onRoute[v] || bound == INF_KEY) continue;
+        uint64_t kv = key + routeKey(g.distance[e], g.cost[e]);
+        if (kv + bound >= bestKey) continue;
+        s.onRoute[v] = 1;
+        s.trail.push_back(v);
+        extendSimpleRoute(g, v, h + 1, kv, destination, legs, exact, s, bestKey);
+        s.trail.pop_back();
+        s.onRoute[v] = 0;
+        if (s.capped) return;
+    }
+}
+
+// Function to find the shortest route from origin to destination with exactly (or at most) the
+// given number of stops, by Bellman-Ford style relaxation over (airport, legs) layers: O(stops * E).
+// With simplePaths set, an airport is never appended to a route that already visits it. Each
+// (airport, legs) pair keeps only its best route, so a simple route whose prefix is not the best one
+// could be missed, but only if the check turned away a label better than the one its pair ended up
+// with, and that label plus a lower bound for the legs left beats the layered answer. Only then are
+// the bounds computed (the same layers run backwards without the check, O(stops * E)) and a
+// depth-first search over simple routes settles the exact answer. That search is exponential in the
+// worst case (the problem is NP-hard), so it stops after SIMPLE_ROUTE_BUDGET routes, sets s.capped,
+// and returns the best route found so far, which may not be the shortest. Routes of more than
+// airportCount - 1 legs are never considered (no simple route is that long), so the arrays stay
+// bounded for any stop count. The route goes to path, origin first (cleared when there is none).
+RouteResult shortestWithStops(const RouteGraph& g, int origin, int destination, int stops,
+    StopsMode mode, bool simplePaths, StopsScratch& s, vector<int>& path) {
+    ROUTE_STATS_SCOPE(StatsQuery::Stops);
+    RouteResult route;
+    path.clear();
+    s.capped = false;
+    int n = g.airportCount;
+    if (stops < 0) return route;
+    if (stops > n - 2) { // stops + 1 legs would exceed n - 1; checked this way round to avoid overflow.
+        if (mode == StopsMode::Exact) return route;
+        stops = n - 2;
+    }
+    int layers = stops + 2; // Routes with 0 .. stops + 1 legs.
+    s.prepare(layers, n);
+
+    s.label[origin] = 0;
+    s.frontier[0].push_back(origin);
+    s.rejected.clear();
+    for (int h = 0; h + 1 < layers; h++) {
+        uint64_t* current = &s.label[(size_t)h * n];
+        uint64_t* next = &s.label[(size_t)(h + 1) * n];
+        int* nextParent = &s.parent[(size_t)(h + 1) * n];
+        for (int u : s.frontier[h]) {
+            if (u == destination && h > 0) continue; // A route ends at the destination.
+            ROUTE_STAT(STAT_SETTLED, 1);
+            ROUTE_STAT(STAT_RELAXED, g.offset[u + 1] - g.offset[u]);
+            for (int e = g.offset[u]; e < g.offset[u + 1]; e++) {
+                int v = g.destination[e];
+                uint64_t kv = current[u] + routeKey(g.distance[e], g.cost[e]);
+                if (kv >= next[v]) continue;
+                if (simplePaths && onLayeredPath(s, n, u, h, v)) {
+                    s.rejected.push_back({ (size_t)(h + 1) * n + v, kv });
+                    continue;
+                }
+                if (next[v] == INF_KEY) s.frontier[h + 1].push_back(v);
+                next[v] = kv;
+                nextParent[v] = u;
+            }
+        }
+    }
+
+    // Pick the answer layer: exactly stops + 1 legs, or the best of 1 .. stops + 1 legs.
+    int bestLayer = -1;
+    uint64_t bestKey = INF_KEY;
+    for (int h = (mode == StopsMode::Exact ? layers - 1 : 1); h < layers; h++) {
+        uint64_t key = s.label[(size_t)h * n + destination];
+        if (key < bestKey) {
+            bestKey = key;
+            bestLayer = h;
+        }
+    }
+    if (bestLayer != -1) {
+        route.found = true;
+        route.distance = keyDistance(bestKey);
+        route.cost = keyCost(bestKey);
+        path.resize(bestLayer + 1);
+        for (int h = bestLayer, at = destination; h >= 0; h--) {
+            path[h] = at;
+            at = s.parent[(size_t)h * n + at];
+        }
+    }
+    // Keep only the labels turned away that beat what their pair finally holds.
+    int kept = 0;
+    for (const pair<size_t, uint64_t>& r : s.rejected)
+        if (r.second < s.label[r.first]) s.rejected[kept++] = r;
+    s.rejected.resize(kept);
+    s.reset(n);
+    if (s.rejected.empty()) return route;
+
+    // bound[r][v]: best label of any walk (simple or not) from v to the destination with exactly r
+    // legs, or at most r legs in AtMost mode.
+    int legs = layers - 1;
+    if (s.bound.size() < (size_t)layers * n) s.bound.resize((size_t)layers * n);
+    fill(s.bound.begin(), s.bound.begin() + n, INF_KEY);
+    s.bound[destination] = 0;
+    for (int r = 1; r <= legs; r++) {
+        const uint64_t* fewer = &s.bound[(size_t)(r - 1) * n];
+        uint64_t* bound = &s.bound[(size_t)r * n];
+        for (int u = 0; u < n; u++) {
+            uint64_t best = mode == StopsMode::AtMost ? fewer[u] : INF_KEY;
+            for (int e = g.offset[u]; e < g.offset[u + 1]; e++) {
+                uint64_t rest = fewer[g.destination[e]];
+                if (rest != INF_KEY) best = min(best, rest + routeKey(g.distance[e], g.cost[e]));
+            }
+            bound[u] = best;
+        }
+    }
+    // A better simple route must pass through a turned-away label that can still beat bestKey.
+    bool promising = false;
+    for (const pair<size_t, uint64_t>& r : s.rejected) {
+        int h = (int)(r.first / n), v = (int)(r.first % n);
+        uint64_t rest = s.bound[(size_t)(legs - h) * n + v];
+        if (rest != INF_KEY && r.second + rest < bestKey) promising = true;
+    }
+    if (!promising) return route;
+    if (s.onRoute.size() < (size_t)n) s.onRoute.resize(n, 0);
+    s.trail.assign(1, origin); // bestKey (the layered answer) is the bound to beat.
+    s.bestTrail.clear();
+    s.expanded = 0;
+    s.onRoute[origin] = 1;
+    if (s.bound[(size_t)legs * n + origin] != INF_KEY)
+        extendSimpleRoute(g, origin, 0, 0, destination, legs, mode == StopsMode::Exact, s, bestKey);
+    s.onRoute[origin] = 0;
+    if (!s.bestTrail.empty()) {
+        route.found = true;
+        route.distance = keyDistance(bestKey);
+        route.cost = keyCost(bestKey);
+        path = s.bestTrail;
+    }
+    return route;
+}
+
+void withNoOfStops(const string& originCode, const string& destCode, int stops) {
+    const RouteGraph& g = routeGraph;
+    int origin = g.findAirport(originCode);    // Index of the origin airport (-1 if unknown).
+    int destination = g.findAirport(destCode); // Index of the destination airport (-1 if unknown).
+
+    // If either the origin or destination airport is not found, print "None".
+    if (origin == -1 || destination == -1) {
+        cout << "\nShortest route from " << originCode << " to " << destCode << ": None" << endl;
+        return;
+    }
+
+    // Layered search for the shortest simple route with exactly the given number of stops.
+    static StopsScratch scratch; // Search arrays reused across calls.
+    static vector<int> path;     // Airports on the route, origin first.
+    RouteResult route;           // Stays not found if the pair is known to be unreachable.
+    bool capped = false;         // Whether the exact search ran out of budget.
+    if (connectivity.reachable(origin, destination) != Reachability::No) {
+        route = shortestWithStops(g, origin, destination, stops, StopsMode::Exact, true, scratch, path);
+        capped = scratch.capped;
+    }
+
+    // If no path with the specified number of stops is found, print "None".
+    if (!route.found) {
+        cout << "\nShortest route from " << originCode << " to " << destCode << " with " << stops << " stops: None";
+        if (capped) cout << " (search capped; a route may exist)";
+    }
+    else {
+        // Print the shortest path, its length, and its cost.
+        cout << "\nShortest route from " << originCode << " to " << destCode << " with " << stops << " stops: ";
+        writeRoute(cout, g, route, path.data(), (int)path.size(), "->");
+        if (capped) cout << " (search capped; a shorter route may exist)";
+        cout << endl;
+    }
+}
+
+//==================== TASK 5 ====================//
+// Count and display direct connections (inbound + outbound), ranked by degree.
+// Degrees come from the graph itself (outbound from the CSR offsets, inbound counted at load time
+// and patched by route changes), so a ranking only sorts airport indices.
+
+// Which degree to rank airports by.
+enum class DegreeKind { Total, Inbound, Outbound };
+
+// Degree counts of one airport.
+struct AirportConnection {
+    int airport;   // Airport index; its code is g.code[airport].
+    int outbound;  // Integer to store the number of outbound connections.
+    int inbound;   // Integer to store the number of inbound connections.
+    int total() const { return inbound + outbound; }
+    int count(DegreeKind kind) const { return kind == DegreeKind::Total ? total() : kind == DegreeKind::Inbound ? inbound : outbound; }
+};
+
+// Function to get the k airports with the most connections of the given kind, most connected first,
+// into top (a buffer owned by the caller, so repeated rankings reuse its capacity). Ties are listed
+// in airport order. O(V log k).
+void topConnectedAirports(const RouteGraph& g, int k, DegreeKind kind, vector<AirportConnection>& top) {
+    top.resize(g.airportCount);
+    for (int i = 0; i < g.airportCount; i++) top[i] = { i, g.degree(i), g.inbound[i] };
+    k = max(0, min(k, g.airportCount));
+    partial_sort(top.begin(), top.begin() + k, top.end(),
+        [kind](const AirportConnection& a, const AirportConnection& b) {
+            int ca = a.count(kind), cb = b.count(kind);
+            return ca > cb || (ca == cb && a.airport < b.airport);
+        });
+    top.resize(k);
+}
+
+void FlightConnections() {
+    const RouteGraph& g = routeGraph;
+    vector<AirportConnection> top;
+    topConnectedAirports(g, g.airportCount, DegreeKind::Total, top);
+    cout << "Airport     Connections\n";
+    for (const AirportConnection& connection : top) {
+        cout << "  " << g.code[connection.airport] << "            " << connection.total() << endl;
+    }
+}
+
+//==================== TASK 6 ====================//
+// Create undirected graph from G following edge rules
+// G_u uses the same CSR layout as the route graph; both directions of every undirected
+// edge are stored, and the airport codes and cities are shared with routeGraph.
+struct UndirectedGraph {
+    int airportCount = 0;     // Number of airports (same as routeGraph).
+    vector<int> offset;       // airportCount + 1 entries; start of each airport's edge range.
+    vector<int> destination;  // Neighbor airport index of each edge.
+    vector<int> cost;         // Cost of each undirected edge.
+    vector<int> edgeId;       // Undirected edge id of each entry (both directions share it).
+    vector<int> edgeU, edgeV; // Endpoints of each undirected edge, edgeU < edgeV, by edge id.
+    vector<int> edgeCost;     // Cost of each undirected edge, by edge id.
+
+    int degree(int u) const { return offset[u + 1] - offset[u]; } // Number of neighbors of u.
+    int edgeCount() const { return (int)edgeU.size(); }           // Number of undirected edges.
+};
+
+UndirectedGraph undirectedGraph; // The undirected graph G_u.
+
+// Function to build G_u from a directed graph in O(E log E). Each leg is keyed by its normalized
+// (min, max) endpoint pair and the keys are sorted, so every airport pair is seen once with all of
+// its legs in either direction; the pair's undirected cost is the cheapest of them. Neighbor lists
+// keep the order in which the pairs first appear in the route graph. Self-loops are dropped.
+UndirectedGraph buildUndirected(const RouteGraph& g) {
+    struct PairLeg {
+        uint64_t pair; // min(u, v) * airportCount + max(u, v).
+        int edge;      // Index of the leg in the route graph.
+    };
+    vector<PairLeg> legs;
+    legs.reserve(g.edgeCount());
+    for (int u = 0; u < g.airportCount; u++) {
+        for (int e = g.offset[u]; e < g.offset[u + 1]; e++) {
+            int v = g.destination[e];
+            if (u == v) continue;
+            legs.push_back({ (uint64_t)min(u, v) * g.airportCount + max(u, v), e });
+        }
+    }
+    sort(legs.begin(), legs.end(), [](const PairLeg& a, const PairLeg& b) {
+        return a.pair < b.pair || (a.pair == b.pair && a.edge < b.edge);
+    });
+
+    // One entry per airport pair, stored at the index of the pair's first leg (its discovery order).
+    vector<int> pairCost(g.edgeCount(), -1);
+    vector<uint64_t> pairKey(g.edgeCount());
+    for (size_t i = 0; i < legs.size();) {
+        size_t j = i;
+        int cheapest = INF;
+        for (; j < legs.size() && legs[j].pair == legs[i].pair; j++) cheapest = min(cheapest, g.cost[legs[j].edge]);
+        pairCost[legs[i].edge] = cheapest; // legs[i] has the smallest edge index of the group.
+        pairKey[legs[i].edge] = legs[i].pair;
+        i = j;
+    }
+
+    // Pack into CSR, visiting the pairs in discovery order.
+    UndirectedGraph gu;
+    gu.airportCount = g.airportCount;
+    gu.offset.assign(g.airportCount + 1, 0);
+    for (int e = 0; e < g.edgeCount(); e++) {
+        if (pairCost[e] == -1) continue;
+        gu.offset[pairKey[e] / g.airportCount + 1]++;
+        gu.offset[pairKey[e] % g.airportCount + 1]++;
+    }
+    for (int i = 0; i < g.airportCount; i++) gu.offset[i + 1] += gu.offset[i];
+    gu.destination.resize(gu.offset[g.airportCount]);
+    gu.cost.resize(gu.offset[g.airportCount]);
+    gu.edgeId.resize(gu.offset[g.airportCount]);
+    vector<int> next(gu.offset.begin(), gu.offset.end() - 1); // Next free slot per airport.
+    for (int e = 0; e < g.edgeCount(); e++) {
+        if (pairCost[e] == -1) continue;
+        int u = (int)(pairKey[e] / g.airportCount), v = (int)(pairKey[e] % g.airportCount);
+        int a = g.destination[e] == v ? u : v; // The leg's origin, whose list saw the pair first.
+        int b = a == u ? v : u;
+        int id = gu.edgeCount(); // Edge ids follow discovery order.
+        gu.edgeU.push_back(u);
+        gu.edgeV.push_back(v);
+        gu.edgeCost.push_back(pairCost[e]);
+        int slot = next[a]++;
+        gu.destination[slot] = b;
+        gu.cost[slot] = pairCost[e];
+        gu.edgeId[slot] = id;
+        slot = next[b]++;
+        gu.destination[slot] = a;
+        gu.cost[slot] = pairCost[e];
+        gu.edgeId[slot] = id;
+    }
+    return gu;
+}
+
+// Function to build the undirected graph.
+void buildUndirectedGraph() {
+    undirectedGraph = buildUndirected(routeGraph);
+}
+
+//Print test
+void GuGraph() {
+    const UndirectedGraph& gu = undirectedGraph;
+    cout << "Graph G_u:\n";
+    for (int i = 0; i < gu.airportCount; i++) {
+        cout << routeGraph.code[i] << " -> ";
+        for (int e = gu.offset[i]; e < gu.offset[i + 1]; e++) {
+            cout << "(" << routeGraph.code[gu.destination[e]] << ",$" << gu.cost[e] << ")";
+            if (e < gu.offset[i + 1] - 1)
+                cout << ",";
+        }
+        cout << "\n" << endl;
+    }
+}
+
+//==================== MST ENGINES ====================//
+// Minimum spanning forests of G_u. Every engine covers all components and returns its edges
+// instead of printing them. Ties are broken by undirected edge id, so all engines pick the same forest.
+
+// One edge of a spanning forest.
+struct MSTEdge {
+    int u, v;  // Endpoint airports.
+    int cost;  // Edge cost.
+};
+
+// Minimum spanning forest of G_u.
+struct MSTResult {
+    vector<MSTEdge> edges;    // Forest edges.
+    long long totalCost = 0;  // Sum of the edge costs.
+    int components = 0;       // Number of trees, counting isolated airports.
+};
+
+// Available MST algorithms.
+enum class MSTEngine {
+    Kruskal,   // Kruskal over radix-sorted edges with a disjoint-set forest.
+    LazyPrim,  // Prim with a heap of candidate edges (stale entries skipped).
+    EagerPrim, // Prim with an indexed heap holding each airport's cheapest connection.
+    Boruvka    // Borůvka rounds, parallel over airports.
+};
+
+// Function to order edges by cost, then by undirected edge id.
+inline uint64_t mstKey(int cost, int edgeId) { return ((uint64_t)(uint32_t)cost << 32) | (uint32_t)edgeId; }
+
+// Lazy Prim: grows one tree per component from a heap of (key, edge slot) candidates.
+MSTResult lazyPrim(const UndirectedGraph& gu) {
+    MSTResult result;
+    vector<char> inTree(gu.airportCount, 0);
+    vector<pair<uint64_t, int>> heap; // (mstKey, slot) of candidate edges leaving the tree.
+    vector<int> slotOwner(gu.destination.size()); // Airport whose list holds each slot.
+    for (int u = 0; u < gu.airportCount; u++) {
+        for (int e = gu.offset[u]; e < gu.offset[u + 1]; e++) slotOwner[e] = u;
+    }
+    auto addVertex = [&](int u) {
+        inTree[u] = 1;
+        ROUTE_STAT(STAT_SETTLED, 1);
+        ROUTE_STAT(STAT_RELAXED, gu.offset[u + 1] - gu.offset[u]);
+        for (int e = gu.offset[u]; e < gu.offset[u + 1]; e++) {
+            if (!inTree[gu.destination[e]]) {
+                heap.push_back({ mstKey(gu.cost[e], gu.edgeId[e]), e });
+                push_heap(heap.begin(), heap.end(), greater<pair<uint64_t, int>>());
+                ROUTE_STAT(STAT_HEAP_OPS, 1);
+            }
+        }
+    };
+    for (int start = 0; start < gu.airportCount; start++) {
+        if (inTree[start]) continue;
+        result.components++;
+        addVertex(start);
+        while (!heap.empty()) {
+            pop_heap(heap.begin(), heap.end(), greater<pair<uint64_t, int>>());
+            int e = heap.back().second;
+            heap.pop_back();
+            ROUTE_STAT(STAT_HEAP_OPS, 1);
+            int v = gu.destination[e];
+            if (inTree[v]) continue; // Both ends already in the tree.
+            result.edges.push_back({ slotOwner[e], v, gu.cost[e] });
+            result.totalCost += gu.cost[e];
+            addVertex(v);
+        }
+    }
+    return result;
+}
+
+// Eager Prim: an indexed 4-ary heap keeps one entry per airport, keyed by its cheapest edge to the tree.
+// Edges are returned in airport order, each airport with the edge that attached it.
+MSTResult eagerPrim(const UndirectedGraph& gu) {
+    MSTResult result;
+    int n = gu.airportCount;
+    vector<char> inTree(n, 0);
+    vector<uint64_t> key(n, INF_KEY);
+    vector<int> parent(n, -1), parentCost(n, 0);
+    QuaternaryHeap heap;
+    heap.clear(n);
+    for (int start = 0; start < n; start++) {
+        if (inTree[start]) continue;
+        result.components++;
+        key[start] = 0;
+        heap.update(start, 0);
+        ROUTE_STAT(STAT_HEAP_OPS, 1);
+        while (!heap.empty()) {
+            int u = heap.pop().second;
+            inTree[u] = 1;
+            ROUTE_STAT(STAT_HEAP_OPS, 1);
+            ROUTE_STAT(STAT_SETTLED, 1);
+            ROUTE_STAT(STAT_RELAXED, gu.offset[u + 1] - gu.offset[u]);
+            for (int e = gu.offset[u]; e < gu.offset[u + 1]; e++) {
+                int v = gu.destination[e];
+                uint64_t k = mstKey(gu.cost[e], gu.edgeId[e]);
+                if (!inTree[v] && k < key[v]) {
+                    key[v] = k;
+                    parent[v] = u;
+                    parentCost[v] = gu.cost[e];
+                    heap.update(v, k);
+                    ROUTE_STAT(STAT_HEAP_OPS, 1);
+                }
+            }
+        }
+    }
+    for (int v = 0; v < n; v++) {
+        if (parent[v] == -1) continue;
+        result.edges.push_back({ parent[v], v, parentCost[v] });
+        result.totalCost += parentCost[v];
+    }
+    return result;
+}
+
+// Borůvka: in every round each component picks its cheapest outgoing edge (in parallel over airports,
+// combined with an atomic minimum), the picked edges are added, and components are merged by pointer
+// jumping. The number of components at least halves per round, so there are O(log V) rounds.
+MSTResult boruvka(const UndirectedGraph& gu, ThreadPool& pool) {
+    MSTResult result;
+    int n = gu.airportCount;
+    vector<int> component(n), next(n);
+    for (int v = 0; v < n; v++) component[v] = v;
+    vector<atomic<uint64_t>> best(n);
+    int blocks = pool.size() * 4;
+    auto forBlocks = [&](int count, const function<void(int, int)>& body) {
+        pool.run(blocks, [&](int b, int) {
+            int begin = (int)((long long)count * b / blocks), end = (int)((long long)count * (b + 1) / blocks);
+            body(begin, end);
+        });
+    };
+
+    while (true) {
+        // Each component's cheapest edge to another component. The pool threads have no query
+        // scope, so the round's edge scan is counted here.
+        ROUTE_STAT(STAT_RELAXED, gu.destination.size());
+        forBlocks(n, [&](int begin, int end) {
+            for (int c = begin; c < end; c++) best[c].store(INF_KEY, memory_order_relaxed);
+        });
+        forBlocks(n, [&](int begin, int end) {
+            for (int u = begin; u < end; u++) {
+                int cu = component[u];
+                uint64_t local = INF_KEY;
+                for (int e = gu.offset[u]; e < gu.offset[u + 1]; e++) {
+                    if (component[gu.destination[e]] != cu) local = min(local, mstKey(gu.cost[e], gu.edgeId[e]));
+                }
+                uint64_t seen = best[cu].load(memory_order_relaxed);
+                while (local < seen && !best[cu].compare_exchange_weak(seen, local, memory_order_relaxed)) {}
+            }
+        });
+
+        // Hook each component onto the component across its cheapest edge. Two components that
+        // picked the same edge point at each other; the smaller id becomes the root.
+        bool merged = false;
+        for (int c = 0; c < n; c++) {
+            next[c] = c;
+            if (component[c] != c || best[c] == INF_KEY) continue;
+            int id = (int)(best[c] & 0xFFFFFFFFu);
+            int a = component[gu.edgeU[id]], b = component[gu.edgeV[id]];
+            next[c] = a == c ? b : a;
+        }
+        for (int c = 0; c < n; c++) {
+            if (component[c] != c || next[c] == c) continue;
+            int other = next[c];
+            if (next[other] == c && c < other) {
+                next[c] = c; // Root of the merged tree; the edge is added from the other side.
+                continue;
+            }
+            int id = (int)(best[c] & 0xFFFFFFFFu);
+            result.edges.push_back({ gu.edgeU[id], gu.edgeV[id], gu.edgeCost[id] });
+            result.totalCost += gu.edgeCost[id];
+            merged = true;
+        }
+        if (!merged) break;
+
+        // Pointer jumping to the new roots, then relabel every airport.
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (int c = 0; c < n; c++) {
+                if (component[c] != c) continue;
+                int root = next[next[c]];
+                if (root != next[c]) {
+                    next[c] = root;
+                    changed = true;
+                }
+            }
+        }
+        forBlocks(n, [&](int begin, int end) {
+            for (int v = begin; v < end; v++) component[v] = next[component[v]];
+        });
+    }
+    for (int v = 0; v < n; v++) result.components += component[v] == v;
+    return result;
+}
+
+// Function to sort undirected edge ids by cost with an LSD radix sort over 16-bit digits.
+// Each pass is stable and the ids start in order, so equal costs stay in edge-id order.
+// Passes whose digit is the same for every edge are skipped.
+vector<int> edgesByCost(const UndirectedGraph& gu) {
+    int m = gu.edgeCount();
+    vector<int> order(m), buffer(m);
+    for (int i = 0; i < m; i++) order[i] = i;
+    vector<int> count(1 << 16);
+    for (int shift = 0; shift < 32; shift += 16) {
+        fill(count.begin(), count.end(), 0);
+        for (int id : order) count[((uint32_t)gu.edgeCost[id] >> shift) & 0xFFFF]++;
+        if (m == 0 || count[((uint32_t)gu.edgeCost[order[0]] >> shift) & 0xFFFF] == m) continue;
+        int sum = 0;
+        for (int& c : count) {
+            int t = c;
+            c = sum;
+            sum += t;
+        }
+        for (int id : order) buffer[count[((uint32_t)gu.edgeCost[id] >> shift) & 0xFFFF]++] = id;
+        order.swap(buffer);
+    }
+    return order;
+}
+
+// Kruskal: scan the edges by cost and keep those joining two different sets. O(E log* V) after the
+// linear-time radix sort.
+MSTResult kruskal(const UndirectedGraph& gu) {
+    MSTResult result;
+    DisjointSet sets(gu.airportCount);
+    for (int id : edgesByCost(gu)) {
+        if (sets.sets == 1) break; // Already a spanning tree.
+        ROUTE_STAT(STAT_RELAXED, 1);
+        if (!sets.unite(gu.edgeU[id], gu.edgeV[id])) continue;
+        ROUTE_STAT(STAT_SETTLED, 1);
+        result.edges.push_back({ gu.edgeU[id], gu.edgeV[id], gu.edgeCost[id] });
+        result.totalCost += gu.edgeCost[id];
+    }
+    result.components = sets.sets;
+    return result;
+}
+
+// Function to compute the minimum spanning forest of G_u with the chosen engine.
+// Borůvka uses pool when given, otherwise a single worker.
+MSTResult minimumSpanningForest(const UndirectedGraph& gu, MSTEngine engine, ThreadPool* pool = nullptr) {
+    ROUTE_STATS_SCOPE(StatsQuery::MST);
+    switch (engine) {
+    case MSTEngine::Kruskal:   return kruskal(gu);
+    case MSTEngine::LazyPrim:  return lazyPrim(gu);
+    case MSTEngine::EagerPrim: return eagerPrim(gu);
+    case MSTEngine::Boruvka:
+        if (pool != nullptr) return boruvka(gu, *pool);
+        ThreadPool single(1);
+        return boruvka(gu, single);
+    }
+    return MSTResult();
+}
+
+//==================== ROUTE UPDATES ====================//
+// Live fare and route changes. A RouteNetwork is one immutable version of the route graph, G_u and
+// its minimum spanning forest. Readers take the current version with currentNetwork() and hold it
+// for the whole query; applyRouteChanges() builds the next version beside it and publishes it with
+// one atomic pointer swap, so a reader never sees a half-applied batch.
+
+// Kinds of change to the directed route graph.
+enum class RouteChangeKind {
+    Add,     // Add one leg origin -> destination.
+    Remove,  // Remove every leg origin -> destination.
+    Reprice  // Set the cost of every leg origin -> destination.
+};
+
+// One change to the directed route graph. Both airports must already exist.
+struct RouteChange {
+    RouteChangeKind kind;
+    string origin, destination; // Airport codes.
+    int distance = 0;           // Distance of an added leg.
+    int cost = 0;               // Cost of an added or repriced leg.
+};
+
+// One published version of the network.
+struct RouteNetwork {
+    RouteGraph graph;           // Directed route graph.
+    RegionIndex regions;        // State and region airport sets of graph.
+    ConnectivityIndex reach;    // Components of graph, for O(1) unreachable checks.
+    ReverseRoutes reverse;      // Reverse of graph, for searches towards a target.
+    shared_ptr<const ContractionHierarchy> hierarchy; // Hierarchy of graph for path queries, or null (Dijkstra).
+    UndirectedGraph undirected; // G_u of graph.
+    vector<int> forest;         // Undirected edge ids of the minimum spanning forest of G_u.
+    long long totalCost = 0;    // Total cost of the forest.
+    long long version = 0;      // Incremented by every applied batch.
+
+    // Function to return the forest as an MSTResult, edges in edge-id order.
+    MSTResult spanningForest() const {
+        MSTResult result;
+        vector<int> ids = forest;
+        sort(ids.begin(), ids.end());
+        for (int id : ids) result.edges.push_back({ undirected.edgeU[id], undirected.edgeV[id], undirected.edgeCost[id] });
+        result.totalCost = totalCost;
+        result.components = undirected.airportCount - (int)forest.size();
+        return result;
+    }
+};
+
+shared_ptr<const RouteNetwork> liveNetwork; // Current version; always accessed with atomic_load and atomic_store.
+mutex networkWriteMutex;                    // Serializes writers and guards their state (see forestRepair).
+
+// Function to get the current network version. The result stays valid for as long as the caller holds it.
+shared_ptr<const RouteNetwork> currentNetwork() {
+    return atomic_load(&liveNetwork);
+}
+
+// Function to get the undirected edge id between u and v, or -1 if they are not neighbors in G_u.
+int findUndirectedEdge(const UndirectedGraph& gu, int u, int v) {
+    for (int e = gu.offset[u]; e < gu.offset[u + 1]; e++) {
+        if (gu.destination[e] == v) return gu.edgeId[e];
+    }
+    return -1;
+}
+
+// Function to publish a route graph as a new network, building G_u and its forest from scratch.
+// The state index is built from g unless regions (for example with named regions loaded) is given.
+// A hierarchy, if given, must have been built for g; versions made by applyRouteChanges() drop it.
+void publishNetwork(const RouteGraph& g, const RegionIndex* regions = nullptr,
+    shared_ptr<const ContractionHierarchy> hierarchy = nullptr) {
+    lock_guard<mutex> lock(networkWriteMutex);
+    auto next = make_shared<RouteNetwork>();
+    next->graph = g;
+    if (regions != nullptr) next->regions = *regions;
+    else next->regions.build(g);
+    next->reach.build(g);
+    next->reverse.build(g);
+    next->hierarchy = move(hierarchy);
+    next->undirected = buildUndirected(g);
+    MSTResult mst = minimumSpanningForest(next->undirected, MSTEngine::Kruskal);
+    for (const MSTEdge& edge : mst.edges) next->forest.push_back(findUndirectedEdge(next->undirected, edge.u, edge.v));
+    next->totalCost = mst.totalCost;
+    shared_ptr<const RouteNetwork> previous = atomic_load(&liveNetwork);
+    next->version = previous ? previous->version + 1 : 1;
+    atomic_store(&liveNetwork, shared_ptr<const RouteNetwork>(next));
+}
+
+// Spanning forest being repaired by applyRouteChanges(). Kept both as adjacency lists of (neighbor,
+// edge id) and as rooted trees (parent pointers), so that a tree path costs O(its depth) and a cut
+// costs O(the smaller side) instead of a walk over the whole tree.
+struct ForestRepair {
+    vector<vector<pair<int, int>>> adjacent; // (neighbor, edge id) of every forest edge.
+    vector<int> parent, parentEdge;          // Parent and edge to it; -1 at roots.
+    vector<int> stamp;                       // Marks of the last path or cut search.
+    int currentStamp = 0;
+    vector<int> side[2];                     // Vertices of the two sides of the last cut.
+
+    // Function to load the forest edges (ids into edgeU and edgeV) and root every tree.
+    void build(int n, const vector<int>& forest, const vector<int>& edgeU, const vector<int>& edgeV) {
+        adjacent.assign(n, {});
+        parent.assign(n, -1);
+        parentEdge.assign(n, -1);
+        stamp.assign(n, 0);
+        currentStamp = 0;
+        for (int id : forest) {
+            adjacent[edgeU[id]].push_back({ edgeV[id], id });
+            adjacent[edgeV[id]].push_back({ edgeU[id], id });
+        }
+        vector<char> seen(n, 0);
+        vector<int> queue;
+        for (int root = 0; root < n; root++) {
+            if (seen[root]) continue;
+            seen[root] = 1;
+            queue.assign(1, root);
+            for (size_t head = 0; head < queue.size(); head++) {
+                for (const auto& [y, id] : adjacent[queue[head]]) {
+                    if (seen[y]) continue;
+                    seen[y] = 1;
+                    parent[y] = queue[head];
+                    parentEdge[y] = id;
+                    queue.push_back(y);
+                }
+            }
+        }
+    }
+
+    // Function to make x the root of its tree by reversing the path from x to the old root.
+    void reroot(int x) {
+        int previous = -1, previousEdge = -1;
+        while (x != -1) {
+            int up = parent[x], upEdge = parentEdge[x];
+            parent[x] = previous;
+            parentEdge[x] = previousEdge;
+            previous = x;
+            previousEdge = upEdge;
+            x = up;
+        }
+    }
+
+    // Function to join the trees of u and v with edge id.
+    void link(int u, int v, int id) {
+        reroot(u);
+        parent[u] = v;
+        parentEdge[u] = id;
+        adjacent[u].push_back({ v, id });
+        adjacent[v].push_back({ u, id });
+    }
+
+    // Function to remove forest edge id between u and v, splitting its tree in two.
+    void cut(int u, int v, int id) {
+        for (int x : { u, v }) {
+            auto& list = adjacent[x];
+            for (size_t i = 0; i < list.size(); i++) {
+                if (list[i].second == id) {
+                    list[i] = list.back();
+                    list.pop_back();
+                    break;
+                }
+            }
+        }
+        int child = parent[u] == v ? u : v;
+        parent[child] = -1;
+        parentEdge[child] = -1;
+    }
+
+    // Function to collect the edge ids on the tree path between u and v. Returns false if u and v are
+    // in different trees.
+    bool path(int u, int v, vector<int>& ids) {
+        ids.clear();
+        currentStamp++;
+        for (int x = u; x != -1; x = parent[x]) stamp[x] = currentStamp;
+        int meet = v;
+        while (meet != -1 && stamp[meet] != currentStamp) meet = parent[meet];
+        if (meet == -1) return false;
+        for (int x = u; x != meet; x = parent[x]) ids.push_back(parentEdge[x]);
+        for (int x = v; x != meet; x = parent[x]) ids.push_back(parentEdge[x]);
+        return true;
+    }
+
+    // Function to find the smaller side after a cut between a and b, growing both sides one vertex at a
+    // time. Returns 0 or 1; side[that] lists its vertices and they are marked with sideStamp(that).
+    int smallerSide(int a, int b) {
+        currentStamp += 2;
+        size_t head[2] = { 0, 0 };
+        side[0].assign(1, a);
+        side[1].assign(1, b);
+        stamp[a] = sideStamp(0);
+        stamp[b] = sideStamp(1);
+        while (true) {
+            for (int s = 0; s < 2; s++) {
+                if (head[s] == side[s].size()) return s;
+                int x = side[s][head[s]++];
+                for (const auto& [y, id] : adjacent[x]) {
+                    if (stamp[y] == sideStamp(s)) continue;
+                    stamp[y] = sideStamp(s);
+                    side[s].push_back(y);
+                }
+            }
+        }
+    }
+    int sideStamp(int s) const { return currentStamp - 1 + s; }
+};
+
+// Writer state, guarded by networkWriteMutex. The rooted forest is kept between batches so that
+// consecutive batches do not re-root every tree; it is rebuilt whenever the network it matches is no
+// longer the one being changed (after publishNetwork, for example).
+ForestRepair forestRepair;                    // Rooted spanning forest of forestNetwork.
+shared_ptr<const RouteNetwork> forestNetwork; // Network forestRepair matches (held, so it is never a stale address).
+
+// Function to apply a batch of changes, in order, and publish the result as the next network version.
+// Only the airports named in the batch are rewritten in the directed graph; only their airport pairs
+// are re-examined in G_u; the spanning forest is repaired edge by edge instead of being rebuilt:
+//   - a forest edge that is removed or gets dearer is cut, and the cheapest edge across the cut
+//     (if any) takes its place;
+//   - a new or cheaper edge joins two trees directly, or replaces the dearest edge on the forest path
+//     between its endpoints if it is cheaper.
+// Changes naming unknown airports, removing or repricing a leg that does not exist, or with a negative
+// distance or cost are reported to errors and skipped. Returns the new version number.
+long long applyRouteChanges(const vector<RouteChange>& changes, ostream& errors = cerr) {
+    lock_guard<mutex> lock(networkWriteMutex);
+    shared_ptr<const RouteNetwork> base = atomic_load(&liveNetwork);
+    if (!base) {
+        errors << "Route changes: no network has been published" << endl;
+        return 0;
+    }
+    const RouteGraph& g = base->graph;
+    const UndirectedGraph& gu = base->undirected;
+    int n = g.airportCount;
+
+    // Directed graph: copy the legs of every touched origin out, apply the changes to them in order.
+    struct EditedLeg {
+        int destination, distance, cost;
+    };
+    vector<int> editedSlot(n, -1);
+    vector<vector<EditedLeg>> edited;
+    vector<uint64_t> pairs; // min * n + max of every touched airport pair.
+    for (const RouteChange& change : changes) {
+        int u = g.findAirport(change.origin), v = g.findAirport(change.destination);
+        if (u == -1 || v == -1) {
+            errors << "Route change " << change.origin << " -> " << change.destination << ": unknown airport, skipped" << endl;
+            continue;
+        }
+        if (change.distance < 0 || change.cost < 0) {
+            errors << "Route change " << change.origin << " -> " << change.destination << ": negative distance or cost, skipped" << endl;
+            continue;
+        }
+        if (editedSlot[u] == -1) {
+            editedSlot[u] = (int)edited.size();
+            edited.emplace_back();
+            for (int e = g.offset[u]; e < g.offset[u + 1]; e++) edited.back().push_back({ g.destination[e], g.distance[e], g.cost[e] });
+        }
+        vector<EditedLeg>& legs = edited[editedSlot[u]];
+        bool exists = any_of(legs.begin(), legs.end(), [&](const EditedLeg& leg) { return leg.destination == v; });
+        if (change.kind != RouteChangeKind::Add && !exists) {
+            errors << "Route change " << change.origin << " -> " << change.destination << ": no such leg, skipped" << endl;
+            continue;
+        }
+        if (change.kind == RouteChangeKind::Add) {
+            legs.push_back({ v, change.distance, change.cost });
+        }
+        else if (change.kind == RouteChangeKind::Remove) {
+            legs.erase(remove_if(legs.begin(), legs.end(), [&](const EditedLeg& leg) { return leg.destination == v; }), legs.end());
+        }
+        else {
+            for (EditedLeg& leg : legs) {
+                if (leg.destination == v) leg.cost = change.cost;
+            }
+        }
+        if (u != v) pairs.push_back((uint64_t)min(u, v) * n + max(u, v));
+    }
+    sort(pairs.begin(), pairs.end());
+    pairs.erase(unique(pairs.begin(), pairs.end()), pairs.end());
+
+    auto next = make_shared<RouteNetwork>();
+    RouteGraph& ng = next->graph;
+    ng.airportCount = n;
+    ng.code = g.code;
+    ng.city = g.city;
+    ng.codeIndex = g.codeIndex;
+    ng.inbound = g.inbound;
+    next->regions = base->regions; // Airports and cities do not change.
+    ng.offset.resize(n + 1);
+    ng.offset[0] = 0;
+    for (int u = 0; u < n; u++) ng.offset[u + 1] = ng.offset[u] + (editedSlot[u] == -1 ? g.degree(u) : (int)edited[editedSlot[u]].size());
+    ng.destination.resize(ng.offset[n]);
+    ng.distance.resize(ng.offset[n]);
+    ng.cost.resize(ng.offset[n]);
+    for (int u = 0; u < n; u++) {
+        int slot = ng.offset[u];
+        if (editedSlot[u] == -1) {
+            copy(g.destination.begin() + g.offset[u], g.destination.begin() + g.offset[u + 1], ng.destination.begin() + slot);
+            copy(g.distance.begin() + g.offset[u], g.distance.begin() + g.offset[u + 1], ng.distance.begin() + slot);
+            copy(g.cost.begin() + g.offset[u], g.cost.begin() + g.offset[u + 1], ng.cost.begin() + slot);
+            continue;
+        }
+        for (int e = g.offset[u]; e < g.offset[u + 1]; e++) ng.inbound[g.destination[e]]--;
+        for (const EditedLeg& leg : edited[editedSlot[u]]) {
+            ng.inbound[leg.destination]++;
+            ng.destination[slot] = leg.destination;
+            ng.distance[slot] = leg.distance;
+            ng.cost[slot++] = leg.cost;
+        }
+    }
+
+    // G_u: the new cheapest cost of every touched pair, compared with its old edge.
+    struct PairChange {
+        int u, v;
+        int oldId;   // Edge id in the old G_u, or -1 for a new pair.
+        int newCost; // Cheapest leg in either direction, or -1 if the pair has no legs left.
+    };
+    vector<PairChange> pairChanges;
+    for (uint64_t pair : pairs) {
+        int u = (int)(pair / n), v = (int)(pair % n);
+        int cheapest = -1;
+        for (int e = ng.offset[u]; e < ng.offset[u + 1]; e++) {
+            if (ng.destination[e] == v && (cheapest == -1 || ng.cost[e] < cheapest)) cheapest = ng.cost[e];
+        }
+        for (int e = ng.offset[v]; e < ng.offset[v + 1]; e++) {
+            if (ng.destination[e] == u && (cheapest == -1 || ng.cost[e] < cheapest)) cheapest = ng.cost[e];
+        }
+        int oldId = findUndirectedEdge(gu, u, v);
+        if (oldId == -1 ? cheapest != -1 : cheapest != gu.edgeCost[oldId]) pairChanges.push_back({ u, v, oldId, cheapest });
+    }
+
+    // Phase 1, on the old G_u: removals and price rises. work holds the costs after them (-1 = removed);
+    // price cuts wait for phase 2. finalCost also has the price cuts.
+    vector<int> work = gu.edgeCost, finalCost = gu.edgeCost;
+    vector<char> inForest(gu.edgeCount(), 0);
+    for (int id : base->forest) inForest[id] = 1;
+    ForestRepair& forest = forestRepair;
+    if (forestNetwork != base) forest.build(n, base->forest, gu.edgeU, gu.edgeV);
+    for (const PairChange& change : pairChanges) {
+        if (change.oldId == -1) continue;
+        finalCost[change.oldId] = change.newCost;
+        if (change.newCost == -1 || change.newCost > gu.edgeCost[change.oldId]) work[change.oldId] = change.newCost;
+    }
+    for (const PairChange& change : pairChanges) {
+        int id = change.oldId;
+        if (id == -1 || (change.newCost != -1 && change.newCost < gu.edgeCost[id]) || !inForest[id]) continue;
+        forest.cut(change.u, change.v, id);
+        inForest[id] = 0;
+        int s = forest.smallerSide(change.u, change.v);
+        uint64_t best = INF_KEY;
+        for (int x : forest.side[s]) {
+            for (int e = gu.offset[x]; e < gu.offset[x + 1]; e++) {
+                int other = gu.edgeId[e];
+                if (work[other] == -1 || forest.stamp[gu.destination[e]] == forest.sideStamp(s)) continue;
+                best = min(best, mstKey(work[other], other));
+            }
+        }
+        if (best == INF_KEY) continue; // The tree splits in two.
+        int replacement = (int)(best & 0xFFFFFFFFu);
+        forest.link(gu.edgeU[replacement], gu.edgeV[replacement], replacement);
+        inForest[replacement] = 1;
+    }
+
+    // New G_u: surviving edges keep their relative id order, new pairs are appended.
+    UndirectedGraph& nu = next->undirected;
+    nu.airportCount = n;
+    vector<int> newId(gu.edgeCount(), -1);
+    for (int id = 0; id < gu.edgeCount(); id++) {
+        if (finalCost[id] == -1) continue;
+        newId[id] = nu.edgeCount();
+        nu.edgeU.push_back(gu.edgeU[id]);
+        nu.edgeV.push_back(gu.edgeV[id]);
+        nu.edgeCost.push_back(finalCost[id]);
+    }
+    vector<vector<pair<int, int>>> added(n); // Per airport: (neighbor, new edge id) of appended pairs.
+    vector<int> cheaper;                     // New ids of new or cheaper edges, for phase 2.
+    for (const PairChange& change : pairChanges) {
+        if (change.oldId != -1) {
+            if (change.newCost != -1 && change.newCost < gu.edgeCost[change.oldId]) cheaper.push_back(newId[change.oldId]);
+            continue;
+        }
+        int id = nu.edgeCount();
+        nu.edgeU.push_back(change.u);
+        nu.edgeV.push_back(change.v);
+        nu.edgeCost.push_back(change.newCost);
+        added[change.u].push_back({ change.v, id });
+        added[change.v].push_back({ change.u, id });
+        cheaper.push_back(id);
+    }
+    nu.offset.resize(n + 1);
+    nu.offset[0] = 0;
+    for (int u = 0; u < n; u++) {
+        int count = (int)added[u].size();
+        for (int e = gu.offset[u]; e < gu.offset[u + 1]; e++) count += newId[gu.edgeId[e]] != -1;
+        nu.offset[u + 1] = nu.offset[u] + count;
+    }
+    nu.destination.resize(nu.offset[n]);
+    nu.cost.resize(nu.offset[n]);
+    nu.edgeId.resize(nu.offset[n]);
+    for (int u = 0; u < n; u++) {
+        int slot = nu.offset[u];
+        for (int e = gu.offset[u]; e < gu.offset[u + 1]; e++) {
+            int id = newId[gu.edgeId[e]];
+            if (id == -1) continue;
+            nu.destination[slot] = gu.destination[e];
+            nu.cost[slot] = nu.edgeCost[id];
+            nu.edgeId[slot++] = id;
+        }
+        for (const auto& [v, id] : added[u]) {
+            nu.destination[slot] = v;
+            nu.cost[slot] = nu.edgeCost[id];
+            nu.edgeId[slot++] = id;
+        }
+    }
+
+    // Phase 2, on the new G_u: new and cheaper edges, by the cycle rule.
+    for (auto& list : forest.adjacent) {
+        for (auto& entry : list) entry.second = newId[entry.second];
+    }
+    for (int& id : forest.parentEdge) {
+        if (id != -1) id = newId[id];
+    }
+    vector<int> pathIds;
+    for (int id : cheaper) {
+        int u = nu.edgeU[id], v = nu.edgeV[id];
+        uint64_t key = mstKey(nu.edgeCost[id], id);
+        if (!forest.path(u, v, pathIds)) {
+            forest.link(u, v, id); // Joins two trees.
+            continue;
+        }
+        uint64_t dearest = 0;
+        int dearestId = -1;
+        for (int pathId : pathIds) {
+            if (pathId == id) { // Already in the forest; a cheaper forest edge stays.
+                dearestId = -1;
+                break;
+            }
+            uint64_t pathKey = mstKey(nu.edgeCost[pathId], pathId);
+            if (pathKey > dearest) {
+                dearest = pathKey;
+                dearestId = pathId;
+            }
+        }
+        if (dearestId == -1 || dearest < key) continue;
+        forest.cut(nu.edgeU[dearestId], nu.edgeV[dearestId], dearestId);
+        forest.link(u, v, id);
+    }
+
+    for (int u = 0; u < n; u++) {
+        for (const auto& [v, id] : forest.adjacent[u]) {
+            if (u < v) {
+                next->forest.push_back(id);
+                next->totalCost += nu.edgeCost[id];
+            }
+        }
+    }
+    // Repricing keeps the legs, and with them the components; anything else rebuilds the index.
+    if (ng.offset == g.offset && ng.destination == g.destination) next->reach = base->reach;
+    else next->reach.build(ng);
+    next->reverse.build(ng);
+    next->version = base->version + 1;
+    forestNetwork = next;
+    atomic_store(&liveNetwork, shared_ptr<const RouteNetwork>(next));
+    return next->version;
+}
+
+//==================== TASK 7 ====================//
+// Prim's MST on G_u
+// Function to run the original array-scan Prim's algorithm: O(V^2), and it only spans the component of
+// the first airport. Kept as the baseline for the MST benchmark.
+MSTResult primArrayScan(const UndirectedGraph& gu) {
+    vector<bool> inMST(gu.airportCount, false);                        // Tracks airports included in the MST.
+    vector<int> key(gu.airportCount, INF), parent(gu.airportCount, -1); // Minimum edge weights and parent nodes.
+
+    key[0] = 0; // Start with the first airport.
+
+    // Iterate until all airports are included in the MST.
+    for (int count = 0; count < gu.airportCount - 1; count++) {
+        int u = -1;         // Integer to store the index of the airport with the minimum key value.
+        int minKey = INF; // Integer to store the minimum key value.
+        // Find the airport with the minimum key value among the unvisited airports.
+        for (int v = 0; v < gu.airportCount; v++) {
+            if (!inMST[v] && key[v] < minKey) {
+                minKey = key[v];
+                u = v;
+            }
+        }
+
+        if (u == -1) break; // If no such airport is found, break.
+        inMST[u] = true;     // Include the selected airport in the MST.
+
+        // Update the key values and parent nodes of the adjacent airports.
+        for (int e = gu.offset[u]; e < gu.offset[u + 1]; e++) {
+            int v = gu.destination[e];
+            int weight = gu.cost[e];
+            if (!inMST[v] && weight < key[v]) {
+                key[v] = weight;
+                parent[v] = u;
+            }
+        }
+    }
+
+    MSTResult result;
+    result.components = 1;
+    for (int i = 1; i < gu.airportCount; i++) {
+        if (parent[i] != -1) {
+            result.edges.push_back({ parent[i], i, key[i] });
+            result.totalCost += key[i];
+        }
+    }
+    return result;
+}
+
+// Function to write the edges and total cost of a spanning forest (formatting layer for MSTResult).
+void writeMST(ostream& out, const RouteGraph& g, const string& title, const MSTResult& mst) {
+    out << "\n" << title << " MST Edges:\n";
+    for (const MSTEdge& edge : mst.edges) {
+        out << g.code[edge.u] << " - " << g.code[edge.v] << " ($" << edge.cost << ")\n";
+    }
+    out << "Total MST cost: $" << mst.totalCost << "\n";
+    if (mst.components > 1) out << "(spanning forest of " << mst.components << " components)\n";
+}
+
+void primMST() {
+    writeMST(cout, routeGraph, "Prim's", minimumSpanningForest(undirectedGraph, MSTEngine::EagerPrim));
+}
+
+//==================== TASK 8 ====================//
+// Kruskal's MST (with a disjoint set)
+void kruskalMST() {
+    writeMST(cout, routeGraph, "Kruskal's", minimumSpanningForest(undirectedGraph, MSTEngine::Kruskal));
+}
+
+//==================== QUERY SERVER ====================//
+// Thread-safe query service over the published network (see ROUTE UPDATES). Requests are text lines;
+// every request is answered from one network version, and each worker owns its search scratch, so
+// queries neither share mutable state nor allocate search arrays. Protocol, one request per line:
+//   path ORIGIN DEST          -> OK <length> <cost> <A->B->...>  |  NONE  |  ERR <reason>
+//   stops ORIGIN DEST N       -> same, for the shortest simple route with exactly N stops; " CAPPED"
+//                                is appended when the search budget ran out (see shortestWithStops)
+//   routes ORIGIN DEST K [distance|cost] -> OK <n>, then n lines "  <length> <cost> <route>", best first
+//   state ORIGIN ST           -> OK <n>, then n lines "  <CODE> <length> <cost> <route>" or "  <CODE> NONE"
+//   region ORIGIN NAME        -> same as state, for a named region
+//   mst                       -> OK <total cost> <edges> <components>
+//   top K [total|in|out]      -> OK <n>, then n lines "  <CODE> <connections>"
+//   stats                     -> OK, then the writeRouteStats() lines (builds with ROUTE_STATS only)
+//   quit                      -> ends the session
+
+// Search scratch and output buffer of one server worker, reused for every request it answers.
+struct QueryWorker {
+    DijkstraScratch dijkstra;
+    HierarchyScratch hierarchy;
+    StopsScratch stops;
+    KShortestScratch alternatives;
+    vector<int> path;
+    RouteSet routes;
+    vector<int> targets;
+    vector<AirportConnection> connections;
+};
+
+// Function to split a request line into at most maxTokens whitespace-separated words.
+// The last word keeps the rest of the line (so region names may contain spaces).
+int splitRequest(string_view line, string_view* tokens, int maxTokens) {
+    int count = 0;
+    size_t i = 0;
+    while (count < maxTokens) {
+        while (i < line.size() && isspace((unsigned char)line[i])) i++;
+        if (i == line.size()) break;
+        size_t end = i;
+        if (count == maxTokens - 1) {
+            end = line.size();
+            while (end > i && isspace((unsigned char)line[end - 1])) end--;
+        }
+        else {
+            while (end < line.size() && !isspace((unsigned char)line[end])) end++;
+        }
+        tokens[count++] = line.substr(i, end - i);
+        i = end;
+    }
+    return count;
+}
+
+// Function to append a route (length, cost and airport codes) to a response.
+void appendRoute(const RouteGraph& g, const RouteResult& route, const int* path, int length, string& out) {
+    out += to_string(route.distance);
+    out += ' ';
+    out += to_string(route.cost);
+    out += ' ';
+    for (int i = 0; i < length; i++) {
+        if (i) out += "->";
+        out += g.code[path[i]];
+    }
+}
+
+// Function to answer the routes from origin to every airport of a destination set.
+// Airports the connectivity index rules out are answered without searching.
+void answerRoutesToAirports(const RouteNetwork& network, int origin, const vector<int>& airports, QueryWorker& w, string& out) {
+    const RouteGraph& g = network.graph;
+    w.targets.clear();
+    for (int v : airports) {
+        if (network.reach.reachable(origin, v) != Reachability::No) w.targets.push_back(v);
+    }
+    shortestRoutesToMany(g, origin, w.targets, defaultHeap, w.dijkstra, w.routes);
+    out += "OK ";
+    out += to_string(airports.size());
+    int next = 0; // Result of the next searched airport.
+    for (int v : airports) {
+        out += "\n  ";
+        out += g.code[v];
+        out += ' ';
+        int i = network.reach.reachable(origin, v) != Reachability::No ? next++ : -1;
+        if (i == -1 || !w.routes.routes[i].found) out += "NONE";
+        else appendRoute(g, w.routes.routes[i], w.routes.path(i), w.routes.pathLength(i), out);
+    }
+}
+
+// Function to answer one request line against a network version. The response (without a final
+// newline) replaces out. Returns false for "quit".
+bool answerQuery(const RouteNetwork& network, string_view line, QueryWorker& w, string& out) {
+    const RouteGraph& g = network.graph;
+    out.clear();
+    string_view word[3]; // Command, origin, rest of the line.
+    int words = splitRequest(line, word, 3);
+    if (words == 0) {
+        out = "ERR empty request";
+        return true;
+    }
+    string_view command = word[0];
+    if (command == "quit") return false;
+    if (command == "stats") {
+#ifdef ROUTE_STATS
+        ostringstream text;
+        writeRouteStats(text);
+        out = "OK\n" + text.str();
+        if (out.back() == '\n') out.pop_back();
+#else
+        out = "ERR statistics not compiled in (build with -DROUTE_STATS)";
+#endif
+        return true;
+    }
+    if (command == "mst") {
+        out = "OK ";
+        out += to_string(network.totalCost);
+        out += ' ';
+        out += to_string(network.forest.size());
+        out += ' ';
+        out += to_string(g.airportCount - (int)network.forest.size());
+        return true;
+    }
+    if (command == "top" && words >= 2) {
+        int k = 0;
+        if (!parseInt(word[1], k) || k < 0) {
+            out = "ERR bad count";
+            return true;
+        }
+        DegreeKind kind = DegreeKind::Total;
+        if (words >= 3 && word[2] == "in") kind = DegreeKind::Inbound;
+        else if (words >= 3 && word[2] == "out") kind = DegreeKind::Outbound;
+        else if (words >= 3 && word[2] != "total") {
+            out = "ERR unknown degree kind";
+            return true;
+        }
+        topConnectedAirports(g, k, kind, w.connections);
+        out = "OK ";
+        out += to_string(w.connections.size());
+        for (const AirportConnection& connection : w.connections) {
+            out += "\n  ";
+            out += g.code[connection.airport];
+            out += ' ';
+            out += to_string(connection.count(kind));
+        }
+        return true;
+    }
+
+    bool known = command == "path" || command == "stops" || command == "routes" || command == "state" || command == "region";
+    if (!known || words < 3) {
+        out = known ? "ERR missing arguments" : "ERR unknown command";
+        return true;
+    }
+    int origin = g.findAirport(word[1]);
+    if (origin == -1) {
+        out = "ERR unknown airport " + string(word[1]);
+        return true;
+    }
+    if (command == "state" || command == "region") {
+        if (command == "state") {
+            string_view state = word[2].substr(0, word[2].find_first_of(" \t"));
+            int id = network.regions.findState(state);
+            static const vector<int> none;
+            answerRoutesToAirports(network, origin, id == -1 ? none : network.regions.stateAirports[id], w, out);
+        }
+        else {
+            int id = network.regions.findRegion(string(word[2]));
+            if (id == -1) out = "ERR unknown region " + string(word[2]);
+            else answerRoutesToAirports(network, origin, network.regions.regionAirports[id], w, out);
+        }
+        return true;
+    }
+
+    string_view rest[3];
+    int restWords = splitRequest(word[2], rest, 3);
+    int destination = g.findAirport(rest[0]);
+    if (destination == -1) {
+        out = "ERR unknown airport " + string(rest[0]);
+        return true;
+    }
+    bool unreachable = network.reach.reachable(origin, destination) == Reachability::No;
+    if (command == "path") {
+        if (unreachable) {
+            out = "NONE";
+            return true;
+        }
+        RouteResult route = network.hierarchy
+            ? hierarchyRoute(*network.hierarchy, origin, destination, w.hierarchy, w.path)
+            : shortestRoute(g, origin, destination, defaultHeap, w.dijkstra, w.path);
+        if (!route.found) {
+            out = "NONE";
+            return true;
+        }
+        out = "OK ";
+        appendRoute(g, route, w.path.data(), (int)w.path.size(), out);
+        return true;
+    }
+    if (command == "routes") {
+        int k = 0;
+        if (restWords < 2 || !parseInt(rest[1], k) || k < 0) {
+            out = "ERR bad route count";
+            return true;
+        }
+        RouteRank rank = RouteRank::Distance;
+        if (restWords >= 3 && rest[2] == "cost") rank = RouteRank::Cost;
+        else if (restWords >= 3 && rest[2] != "distance") {
+            out = "ERR unknown ranking";
+            return true;
+        }
+        if (unreachable) k = 0;
+        kShortestRoutes(g, network.reverse, origin, destination, k, rank, w.alternatives, w.routes);
+        out = "OK ";
+        out += to_string(w.routes.size());
+        for (int i = 0; i < w.routes.size(); i++) {
+            out += "\n  ";
+            appendRoute(g, w.routes.routes[i], w.routes.path(i), w.routes.pathLength(i), out);
+        }
+        return true;
+    }
+    int stops = 0;
+    if (restWords < 2 || !parseInt(rest[1], stops) || stops < 0 || stops > g.airportCount - 2) {
+        out = "ERR bad stop count"; // A simple route has at most airportCount - 1 legs.
+        return true;
+    }
+    RouteResult route;
+    if (!unreachable) route = shortestWithStops(g, origin, destination, stops, StopsMode::Exact, true, w.stops, w.path);
+    if (!route.found) out = "NONE";
+    else {
+        out = "OK ";
+        appendRoute(g, route, w.path.data(), (int)w.path.size(), out);
+    }
+    if (!unreachable && w.stops.capped) out += " CAPPED";
+    return true;
+}
+
+// Request lines are answered in blocks of up to this many, in parallel.
+const int SERVER_BLOCK = 1024;
+
+// Function to answer request lines from in until end of input or "quit", writing the responses to out
+// in request order. Whatever input is already buffered (up to SERVER_BLOCK lines) forms one block,
+// answered in parallel on pool against one network version; workers needs one entry per pool worker.
+void serveStream(istream& in, ostream& out, ThreadPool& pool, vector<QueryWorker>& workers) {
+    vector<string> lines(SERVER_BLOCK), responses(SERVER_BLOCK);
+    vector<char> keepGoing(SERVER_BLOCK);
+    bool open = true;
+    while (open) {
+        int count = 0;
+        while (count < SERVER_BLOCK && getline(in, lines[count])) {
+            count++;
+            if (in.rdbuf()->in_avail() <= 0) break; // Answer what has arrived before waiting for more.
+        }
+        if (count == 0) break;
+        shared_ptr<const RouteNetwork> network = currentNetwork();
+        pool.run(count, [&](int i, int worker) {
+            keepGoing[i] = answerQuery(*network, lines[i], workers[worker], responses[i]);
+        });
+        for (int i = 0; i < count && open; i++) {
+            if (!keepGoing[i]) open = false;
+            else out << responses[i] << '\n';
+        }
+        out.flush();
+    }
+}
+
+#ifndef _WIN32
+// Function to send all size bytes of data on connection, retrying short and interrupted writes.
+// Returns false once the client has gone away.
+bool sendAll(int connection, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(connection, data, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        data += sent;
+        size -= (size_t)sent;
+    }
+    return true;
+}
+
+// Function to serve requests on a Unix domain socket at path. Every pool worker accepts and serves
+// one connection at a time with its own entry in workers, so at most pool.size() clients are served
+// at once and further ones wait in the listen backlog. Runs until the process is stopped; returns
+// false if the socket cannot be set up.
+bool serveSocket(const string& path, ThreadPool& pool, vector<QueryWorker>& workers) {
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (listener < 0 || path.size() >= sizeof(address.sun_path)) return false;
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    unlink(path.c_str());
+    if (::bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 64) != 0) {
+        close(listener);
+        return false;
+    }
+
+    // One never-ending task per worker: the pool owns every connection thread and joins them.
+    pool.run(pool.size(), [&](int, int worker) {
+        QueryWorker& w = workers[worker];
+        string pending, response;
+        char buffer[4096];
+        while (true) {
+            int connection = accept(listener, nullptr, nullptr);
+            if (connection < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                // Out of descriptors or similar: wait rather than spin until the condition clears.
+                cerr << "accept failed: " << strerror(errno) << endl;
+                this_thread::sleep_for(chrono::milliseconds(100));
+                continue;
+            }
+            bool open = true;
+            while (open) {
+                ssize_t got = read(connection, buffer, sizeof(buffer));
+                if (got < 0 && errno == EINTR) continue;
+                if (got <= 0) break;
+                pending.append(buffer, (size_t)got);
+                size_t start = 0, end;
+                while (open && (end = pending.find('\n', start)) != string::npos) {
+                    string_view line(pending.data() + start, end - start);
+                    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+                    open = answerQuery(*currentNetwork(), line, w, response);
+                    response += '\n';
+                    if (open) open = sendAll(connection, response.data(), response.size());
+                    start = end + 1;
+                }
+                pending.erase(0, start);
+            }
+            pending.clear();
+            close(connection);
+        }
+    });
+    return true;
+}
+#endif
+
+//==================== BENCHMARKS ====================//
+// Synthetic networks and timing harnesses, selected with command-line switches in main().
+
+// Function to make a synthetic airport code from an index (AAAA, AAAB, ...).
+string syntheticCode(int index) {
+    string code(4, 'A');
+    for (int i = 3; i >= 0 && index > 0; i--) {
+        code[i] = (char)('A' + index % 26);
+        index /= 26;
+    }
+    for (; index > 0; index /= 26) code.insert(code.begin(), (char)('A' + index % 26)); // Beyond 26^4 airports.
+    return code;
+}
+
+// Function to build a random route graph: a ring through every airport (so every pair is connected)
+// plus legsPerAirport - 1 random legs per airport. The same seed always gives the same graph.
+RouteGraph makeRandomGraph(int airportCount, int legsPerAirport, uint64_t seed) {
+    mt19937_64 rng(seed);
+    RouteGraphBuilder builder;
+    for (int i = 0; i < airportCount; i++) builder.getAirportIndex(syntheticCode(i));
+    builder.legs.reserve((size_t)airportCount * legsPerAirport);
+    for (int u = 0; u < airportCount; u++) {
+        builder.legs.push_back({ u, (u + 1) % airportCount, (int)(50 + rng() % 2950), (int)(30 + rng() % 970) });
+        for (int k = 1; k < legsPerAirport; k++) {
+            int v = (int)(rng() % airportCount);
+            if (v == u) continue;
+            builder.legs.push_back({ u, v, (int)(50 + rng() % 2950), (int)(30 + rng() % 970) });
+        }
+    }
+    return builder.finalize();
+}
+
+// Function to make a synthetic "City XXXX, ST" name for an airport at (x, y) on the 3000 x 3000 map.
+// The map is cut into a 7 x 7 grid of states (AA .. GG), so state queries have realistic targets.
+string syntheticCity(int index, double x, double y) {
+    int column = min(6, (int)(x / (3000.0 / 7))), row = min(6, (int)(y / (3000.0 / 7)));
+    return "City " + syntheticCode(index) + ", " + (char)('A' + column) + (char)('A' + row);
+}
+
+// Function to build a random hub-and-spoke network on a 3000 x 3000 map: every airport gets random
+// coordinates, hubs link to their nearest hubs plus a few random ones, and every other airport links
+// to its nearest hubs. Legs run both ways; distance is the straight-line distance and the cost grows
+// with it, plus noise. The same seed always gives the same graph.
+RouteGraph makeHubGraph(int airportCount, int hubCount, uint64_t seed) {
+    mt19937_64 rng(seed);
+    hubCount = max(2, min(hubCount, airportCount));
+    vector<double> x(airportCount), y(airportCount);
+    for (int i = 0; i < airportCount; i++) {
+        x[i] = (double)(rng() % 3000000) / 1000;
+        y[i] = (double)(rng() % 3000000) / 1000;
+    }
+    RouteGraphBuilder builder;
+    for (int i = 0; i < airportCount; i++) {
+        builder.getAirportIndex(syntheticCode(i));
+        builder.city[i] = syntheticCity(i, x[i], y[i]);
+    }
+    auto addBoth = [&](int u, int v) {
+        int distance = 10 + (int)hypot(x[u] - x[v], y[u] - y[v]);
+        builder.legs.push_back({ u, v, distance, 30 + distance / 4 + (int)(rng() % 100) });
+        builder.legs.push_back({ v, u, distance, 30 + distance / 4 + (int)(rng() % 100) });
+    };
+    // Airports 0 .. hubCount - 1 are the hubs, bucketed on a grid so that a nearest-hub lookup
+    // scans rings of cells outwards instead of every hub.
+    int side = max(1, (int)sqrt(hubCount / 2.0));
+    double cellSize = 3000.0 / side;
+    auto cellOf = [&](double c) { return min(side - 1, (int)(c / cellSize)); };
+    vector<vector<int>> cell((size_t)side * side);
+    for (int h = 0; h < hubCount; h++) cell[(size_t)cellOf(y[h]) * side + cellOf(x[h])].push_back(h);
+    vector<pair<double, int>> hubs;
+    auto nearestHubs = [&](int u, int count) -> const vector<pair<double, int>>& {
+        hubs.clear();
+        int cx = cellOf(x[u]), cy = cellOf(y[u]);
+        for (int r = 0; r < side; r++) {
+            for (int gy = max(0, cy - r); gy <= min(side - 1, cy + r); gy++) {
+                for (int gx = max(0, cx - r); gx <= min(side - 1, cx + r); gx++) {
+                    if (max(abs(gx - cx), abs(gy - cy)) != r) continue; // Inner rings were scanned already.
+                    for (int h : cell[(size_t)gy * side + gx]) {
+                        if (h != u) hubs.push_back({ hypot(x[u] - x[h], y[u] - y[h]), h });
+                    }
+                }
+            }
+            // Hubs outside ring r are at least r cells away, so the answer is final once the
+            // count-th nearest candidate is closer than that.
+            if ((int)hubs.size() >= count) {
+                partial_sort(hubs.begin(), hubs.begin() + count, hubs.end());
+                if (hubs[count - 1].first < r * cellSize) break;
+            }
+        }
+        count = min(count, (int)hubs.size());
+        partial_sort(hubs.begin(), hubs.begin() + count, hubs.end());
+        hubs.resize(count);
+        return hubs;
+    };
+    for (int h = 0; h < hubCount; h++) {
+        for (const auto& [d, other] : nearestHubs(h, 4)) {
+            if (other > h) addBoth(h, other);
+        }
+        addBoth(h, (int)(rng() % hubCount)); // Long-haul link.
+    }
+    for (int u = hubCount; u < airportCount; u++) {
+        for (const auto& [d, hub] : nearestHubs(u, 1 + (int)(rng() % 3))) addBoth(u, hub);
+    }
+    return builder.finalize();
+}
+
+// Function to build a random geometric network on the same map: airports get random coordinates and
+// every pair closer than a radius is linked both ways, the radius being chosen so that an airport
+// has about meanDegree neighbors. Neighbors are found through a grid of radius-sized cells.
+// Sparse settings can leave airports isolated. The same seed always gives the same graph.
+RouteGraph makeGeometricGraph(int airportCount, double meanDegree, uint64_t seed) {
+    mt19937_64 rng(seed);
+    vector<double> x(airportCount), y(airportCount);
+    for (int i = 0; i < airportCount; i++) {
+        x[i] = (double)(rng() % 3000000) / 1000;
+        y[i] = (double)(rng() % 3000000) / 1000;
+    }
+    RouteGraphBuilder builder;
+    for (int i = 0; i < airportCount; i++) {
+        builder.getAirportIndex(syntheticCode(i));
+        builder.city[i] = syntheticCity(i, x[i], y[i]);
+    }
+    double radius = sqrt(meanDegree * 3000.0 * 3000.0 / (3.14159265358979 * max(1, airportCount)));
+    int side = max(1, (int)(3000.0 / radius)); // Cells are at least one radius wide.
+    double cellSize = 3000.0 / side;
+    auto cellOf = [&](double c) { return min(side - 1, (int)(c / cellSize)); };
+    vector<int> cellStart((size_t)side * side + 1, 0), cellAirports(airportCount);
+    for (int i = 0; i < airportCount; i++) cellStart[(size_t)cellOf(y[i]) * side + cellOf(x[i]) + 1]++;
+    for (size_t c = 0; c + 1 < cellStart.size(); c++) cellStart[c + 1] += cellStart[c];
+    vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+    for (int i = 0; i < airportCount; i++) cellAirports[fill[(size_t)cellOf(y[i]) * side + cellOf(x[i])]++] = i;
+
+    builder.legs.reserve((size_t)(airportCount * meanDegree * 1.1));
+    for (int u = 0; u < airportCount; u++) {
+        int cx = cellOf(x[u]), cy = cellOf(y[u]);
+        for (int gy = max(0, cy - 1); gy <= min(side - 1, cy + 1); gy++) {
+            for (int gx = max(0, cx - 1); gx <= min(side - 1, cx + 1); gx++) {
+                size_t c = (size_t)gy * side + gx;
+                for (int k = cellStart[c]; k < cellStart[c + 1]; k++) {
+                    int v = cellAirports[k];
+                    double d = hypot(x[u] - x[v], y[u] - y[v]);
+                    if (v <= u || d >= radius) continue; // Each pair once, from its smaller index.
+                    int distance = 10 + (int)d;
+                    builder.legs.push_back({ u, v, distance, 30 + distance / 4 + (int)(rng() % 100) });
+                    builder.legs.push_back({ v, u, distance, 30 + distance / 4 + (int)(rng() % 100) });
+                }
+            }
+        }
+    }
+    return builder.finalize();
+}
+
+// Function to return the p-th percentile (0..100) of a list of samples.
+double percentile(vector<double> samples, double p) {
+    if (samples.empty()) return 0;
+    sort(samples.begin(), samples.end());
+    size_t i = (size_t)(p / 100.0 * (samples.size() - 1) + 0.5);
+    return samples[i];
+}
+
+// Function to time point-to-point queries for every Dijkstra backend on random graphs.
+// The O(V^2) scan (the original implementation) is only run where it finishes in reasonable time.
+void benchDijkstra(const vector<int>& sizes, int queries) {
+    const char* names[] = { "scan", "binary", "4-ary", "radix" };
+    HeapKind kinds[] = { HeapKind::Scan, HeapKind::Binary, HeapKind::Quaternary, HeapKind::Radix };
+    cout << left << setw(10) << "airports" << setw(10) << "legs" << setw(10) << "backend"
+        << setw(10) << "queries" << setw(14) << "mean_us" << setw(14) << "p50_us" << setw(14) << "p99_us" << endl;
+
+    for (int n : sizes) {
+        RouteGraph g = makeRandomGraph(n, 8, 12345);
+        mt19937_64 rng(n);
+        vector<pair<int, int>> pairs(queries);
+        for (auto& q : pairs) q = { (int)(rng() % n), (int)(rng() % n) };
+
+        DijkstraScratch scratch;
+        vector<uint64_t> expected(queries, INF_KEY); // Labels from the first backend, to cross-check the others.
+        for (int b = 0; b < 4; b++) {
+            // The scan costs O(V^2) per query: limit it to a few queries, and skip it on the largest graphs.
+            int count = queries;
+            if (kinds[b] == HeapKind::Scan) {
+                if (n > 200000) {
+                    cout << left << setw(10) << n << setw(10) << g.edgeCount() << setw(10) << names[b] << "skipped (O(V^2))" << endl;
+                    continue;
+                }
+                count = max(1, min(queries, (int)(2e9 / ((double)n * n))));
+            }
+            vector<double> samples;
+            for (int q = 0; q < count; q++) {
+                auto start = chrono::steady_clock::now();
+                dijkstra(g, pairs[q].first, pairs[q].second, kinds[b], scratch);
+                auto stop = chrono::steady_clock::now();
+                samples.push_back(chrono::duration<double, micro>(stop - start).count());
+
+                uint64_t label = scratch.key[pairs[q].second];
+                if (expected[q] == INF_KEY) expected[q] = label;
+                else if (expected[q] != label) cerr << "backend " << names[b] << " disagrees on query " << q << endl;
+            }
+            double mean = 0;
+            for (double t : samples) mean += t;
+            mean /= samples.size();
+            cout << left << setw(10) << n << setw(10) << g.edgeCount() << setw(10) << names[b] << setw(10) << count
+                << setw(14) << fixed << setprecision(1) << mean << setw(14) << percentile(samples, 50)
+                << setw(14) << percentile(samples, 99) << endl;
+        }
+    }
+}
+
+// Function to compare the layered search with the DFS reference on one query; true if they agree.
+bool sameStopsAnswer(const RouteGraph& g, int origin, int destination, int stops, StopsScratch& scratch, vector<int>& path) {
+    vector<bool> visited(g.airportCount, false);
+    vector<int> bestPath, trail;
+    int distance = INF, cost = INF;
+    dfs(g, origin, destination, stops + 1, 0, 0, distance, cost, visited, trail, bestPath);
+    RouteResult route = shortestWithStops(g, origin, destination, stops, StopsMode::Exact, true, scratch, path);
+    if (!route.found) return distance == INF;
+    if (route.distance != distance || (int)path.size() != stops + 2 || path.front() != origin || path.back() != destination) return false;
+    vector<char> seen(g.airportCount, 0);
+    for (int v : path) {
+        if (seen[v]) return false; // Not a simple route.
+        seen[v] = 1;
+    }
+    return true;
+}
+
+// Function to time exact-stop queries: exhaustive DFS against the layered engine, on a dense
+// random network. Also counts how often the two disagree on the best distance.
+void benchStops(int airportCount, int legsPerAirport, int maxStops, int queries) {
+    StopsScratch checkScratch;
+    vector<int> checkPath;
+    int checked = 0, wrong = 0;
+    {
+        // A route whose prefix to XXX is not the best one: AAA->ZZZ->XXX->YYY->DDD with 3 stops.
+        RouteGraphBuilder builder;
+        const char* legs[][2] = { { "AAA", "YYY" }, { "YYY", "XXX" }, { "AAA", "ZZZ" }, { "ZZZ", "XXX" }, { "XXX", "YYY" }, { "YYY", "DDD" } };
+        int weight[] = { 1, 1, 5, 5, 1, 1 };
+        for (int i = 0; i < 6; i++) builder.addLeg(legs[i][0], legs[i][1], "", "", weight[i], weight[i]);
+        RouteGraph small = builder.finalize();
+        checked++;
+        wrong += !sameStopsAnswer(small, small.findAirport("AAA"), small.findAirport("DDD"), 3, checkScratch, checkPath);
+    }
+    for (uint64_t seed = 1; seed <= 40; seed++) {
+        RouteGraph small = makeRandomGraph(8, 3, seed);
+        for (int stops = 0; stops <= 4; stops++) {
+            for (int u = 0; u < small.airportCount; u++) {
+                for (int v = 0; v < small.airportCount; v++) {
+                    checked++;
+                    wrong += !sameStopsAnswer(small, u, v, stops, checkScratch, checkPath);
+                }
+            }
+        }
+    }
+    cout << "checked " << checked << " queries against DFS on small graphs: " << wrong << " wrong" << endl;
+    {
+        // Worst case for the exact search: origin and destination are leaves of one hub in a dense
+        // cluster, so walks back through the hub are turned away and no simple route has 2+ stops.
+        RouteGraphBuilder builder;
+        int cluster = 1999;
+        for (int i = 0; i < cluster + 2; i++) builder.getAirportIndex(syntheticCode(i));
+        mt19937_64 rng(cluster);
+        for (int u = 0; u < cluster; u++) {
+            for (int k = 0; k < 42; k++) {
+                int v = (int)(rng() % cluster);
+                if (v != u) builder.legs.push_back({ u, v, (int)(50 + rng() % 2950), (int)(30 + rng() % 970) });
+            }
+        }
+        builder.legs.push_back({ cluster, 0, 100, 100 });
+        builder.legs.push_back({ 0, cluster + 1, 100, 100 });
+        RouteGraph hub = builder.finalize();
+        for (int stops = 4; stops <= 7; stops++) {
+            auto start = chrono::steady_clock::now();
+            RouteResult route = shortestWithStops(hub, cluster, cluster + 1, stops, StopsMode::Exact, true, checkScratch, checkPath);
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            cout << "hub leaves, " << stops << " stops: " << (route.found ? "found" : "none") << " in " << fixed
+                << setprecision(1) << ms << " ms" << (checkScratch.capped ? " (capped)" : "") << endl;
+        }
+    }
+
+    RouteGraph g = makeRandomGraph(airportCount, legsPerAirport, 777);
+    mt19937_64 rng(airportCount);
+    StopsScratch scratch;
+    vector<int> layeredPath;
+    cout << "airports " << g.airportCount << ", legs " << g.edgeCount() << endl;
+    cout << left << setw(8) << "stops" << setw(10) << "queries" << setw(16) << "dfs_mean_us"
+        << setw(16) << "layered_mean_us" << setw(10) << "speedup" << setw(10) << "mismatch" << endl;
+
+    for (int stops = 0; stops <= maxStops; stops++) {
+        double dfsTime = 0, layeredTime = 0;
+        int mismatches = 0;
+        for (int q = 0; q < queries; q++) {
+            int origin = (int)(rng() % g.airportCount), destination = (int)(rng() % g.airportCount);
+
+            auto start = chrono::steady_clock::now();
+            vector<bool> visited(g.airportCount, false);
+            vector<int> bestPath, path;
+            int distance = INF, cost = INF;
+            dfs(g, origin, destination, stops + 1, 0, 0, distance, cost, visited, path, bestPath);
+            auto middle = chrono::steady_clock::now();
+            RouteResult route = shortestWithStops(g, origin, destination, stops, StopsMode::Exact, true, scratch, layeredPath);
+            auto stop = chrono::steady_clock::now();
+
+            dfsTime += chrono::duration<double, micro>(middle - start).count();
+            layeredTime += chrono::duration<double, micro>(stop - middle).count();
+            if ((distance == INF) != !route.found || (route.found && route.distance != distance)) mismatches++;
+        }
+        cout << left << setw(8) << stops << setw(10) << queries << setw(16) << fixed << setprecision(1) << dfsTime / queries
+            << setw(16) << layeredTime / queries << setw(10) << dfsTime / layeredTime << setw(10) << mismatches << endl;
+    }
+}
+
+// Function to check that two route graphs are identical, array by array.
+bool sameGraph(const RouteGraph& a, const RouteGraph& b) {
+    return a.airportCount == b.airportCount && a.code == b.code && a.city == b.city && a.offset == b.offset
+        && a.destination == b.destination && a.distance == b.distance && a.cost == b.cost;
+}
+
+// Function to time sequential and parallel loading of a CSV file and check that they agree.
+void benchLoad(const string& filename, int threads) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        cerr << "Cannot open " << filename << endl;
+        return;
+    }
+    RouteGraph sequential, parallel;
+    auto start = chrono::steady_clock::now();
+    loadRouteGraph(file, filename, sequential);
+    auto middle = chrono::steady_clock::now();
+    {
+        ThreadPool pool(threads);
+        loadRouteGraphParallel(file, filename, pool, parallel);
+    }
+    auto stop = chrono::steady_clock::now();
+    cout << "airports " << sequential.airportCount << ", legs " << sequential.edgeCount() << endl;
+    cout << "sequential: " << fixed << setprecision(3) << chrono::duration<double>(middle - start).count() << " s" << endl;
+    cout << "parallel (" << threads << " threads): " << chrono::duration<double>(stop - middle).count() << " s" << endl;
+    cout << "identical: " << (sameGraph(sequential, parallel) ? "yes" : "no") << endl;
+}
+
+// Function to check a snapshot against the CSV it was made from: the graph arrays must match,
+// every code must resolve to the same airport, and random shortest-path queries must agree.
+bool verifySnapshot(const string& csvFile, const string& snapshotFile, int queries) {
+    MappedFile file;
+    if (!file.open(csvFile)) {
+        cerr << "Cannot open " << csvFile << endl;
+        return false;
+    }
+    RouteGraph fromCsv, fromSnapshot;
+    loadRouteGraph(file, csvFile, fromCsv);
+    auto start = chrono::steady_clock::now();
+    if (!loadSnapshot(snapshotFile, fromSnapshot)) return false;
+    auto stop = chrono::steady_clock::now();
+    cout << "snapshot load: " << fixed << setprecision(3) << chrono::duration<double, milli>(stop - start).count() << " ms" << endl;
+
+    bool ok = sameGraph(fromCsv, fromSnapshot);
+    for (int i = 0; i < fromCsv.airportCount && ok; i++) ok = fromSnapshot.findAirport(fromCsv.code[i]) == i;
+    cout << "graph arrays and code index: " << (ok ? "match" : "DIFFER") << endl;
+
+    mt19937_64 rng(42);
+    DijkstraScratch a, b;
+    vector<int> pathA, pathB;
+    int mismatches = 0;
+    for (int q = 0; q < queries && fromCsv.airportCount > 0; q++) {
+        int origin = (int)(rng() % fromCsv.airportCount), destination = (int)(rng() % fromCsv.airportCount);
+        dijkstra(fromCsv, origin, destination, defaultHeap, a);
+        dijkstra(fromSnapshot, origin, destination, defaultHeap, b);
+        if (a.key[destination] != b.key[destination]) mismatches++;
+        else if (a.reached(destination)) {
+            tracePath(a, destination, pathA);
+            tracePath(b, destination, pathB);
+            if (pathA != pathB) mismatches++;
+        }
+    }
+    cout << queries << " shortest-path queries, " << mismatches << " mismatches" << endl;
+    return ok && mismatches == 0;
+}
+
+// Function to time batch shortest paths for 1, 2, 4, ... up to maxThreads threads and check
+// that every run produces the same matrix.
+void benchBatch(int airportCount, int originCount, int maxThreads) {
+    RouteGraph g = makeRandomGraph(airportCount, 8, 99);
+    vector<int> origins(originCount);
+    for (int i = 0; i < originCount; i++) origins[i] = (int)((long long)i * airportCount / originCount);
+    cout << "airports " << g.airportCount << ", legs " << g.edgeCount() << ", origins " << originCount << endl;
+    cout << left << setw(10) << "threads" << setw(10) << "layout" << setw(14) << "seconds" << setw(16) << "origins_per_s" << setw(10) << "same" << endl;
+
+    RouteMatrix reference;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        for (MatrixLayout layout : { MatrixLayout::Dense, MatrixLayout::Tiled }) {
+            ThreadPool pool(threads);
+            RouteMatrix matrix;
+            auto start = chrono::steady_clock::now();
+            batchShortestPaths(g, origins, layout, pool, matrix);
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+            bool same = true;
+            if (reference.rows == 0) reference = matrix;
+            for (int r = 0; r < matrix.rows && same; r++) {
+                for (int c = 0; c < matrix.columns && same; c++) {
+                    same = matrix.distanceAt(r, c) == reference.distanceAt(r, c) && matrix.costAt(r, c) == reference.costAt(r, c);
+                }
+            }
+            cout << left << setw(10) << threads << setw(10) << (layout == MatrixLayout::Dense ? "dense" : "tiled")
+                << setw(14) << fixed << setprecision(3) << seconds << setw(16) << setprecision(1) << originCount / seconds
+                << setw(10) << (same ? "yes" : "NO") << endl;
+        }
+    }
+}
+
+// Function to time every MST engine on random networks and check that they agree on the total cost.
+// The legacy O(V^2) Prim is skipped where it would take minutes.
+void benchMST(const vector<int>& sizes, int threads) {
+    ThreadPool pool(threads);
+    cout << left << setw(12) << "airports" << setw(12) << "edges" << setw(14) << "engine" << setw(12) << "seconds"
+        << setw(16) << "total" << setw(10) << "same" << endl;
+    for (int n : sizes) {
+        UndirectedGraph gu = buildUndirected(makeRandomGraph(n, 4, 7));
+        struct Engine {
+            const char* name;
+            function<MSTResult()> run;
+            bool enabled;
+        };
+        vector<Engine> engines = {
+            { "prim-scan", [&] { return primArrayScan(gu); }, n <= 100000 },
+            { "kruskal", [&] { return minimumSpanningForest(gu, MSTEngine::Kruskal); }, true },
+            { "lazy-prim", [&] { return minimumSpanningForest(gu, MSTEngine::LazyPrim); }, true },
+            { "eager-prim", [&] { return minimumSpanningForest(gu, MSTEngine::EagerPrim); }, true },
+            { "boruvka", [&] { return minimumSpanningForest(gu, MSTEngine::Boruvka, &pool); }, true },
+        };
+        long long reference = -1;
+        for (const Engine& engine : engines) {
+            if (!engine.enabled) continue;
+            auto start = chrono::steady_clock::now();
+            MSTResult mst = engine.run();
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            if (reference == -1) reference = mst.totalCost;
+            cout << left << setw(12) << n << setw(12) << gu.edgeCount() << setw(14) << engine.name << setw(12) << fixed
+                << setprecision(4) << seconds << setw(16) << mst.totalCost << setw(10) << (mst.totalCost == reference ? "yes" : "NO") << endl;
+        }
+    }
+}
+
+// Function to time batches of random route changes against a full G_u and MST rebuild, with a reader
+// thread querying the live network the whole time. Every version is checked against Kruskal from scratch.
+// Halfway through, a fresh network is published.
+void benchUpdates(int airportCount, int batches, int batchSize) {
+    publishNetwork(makeRandomGraph(airportCount, 4, 11));
+    mt19937_64 rng(5);
+    atomic<bool> done(false);
+    atomic<long long> queries(0);
+    thread reader([&] {
+        DijkstraScratch scratch;
+        mt19937_64 readerRng(6);
+        while (!done) {
+            shared_ptr<const RouteNetwork> network = currentNetwork(); // One consistent version per query.
+            dijkstra(network->graph, (int)(readerRng() % network->graph.airportCount), -1, defaultHeap, scratch);
+            queries++;
+        }
+    });
+
+    vector<double> updateMs, rebuildMs;
+    bool same = true;
+    ostringstream skipped;
+    for (int b = 0; b < batches; b++) {
+        // Halfway through, start over from a fresh network; the writer state must follow it.
+        if (b == batches / 2) publishNetwork(makeRandomGraph(airportCount, 4, 12));
+        vector<RouteChange> changes;
+        for (int i = 0; i < batchSize; i++) {
+            RouteChange change;
+            change.kind = (RouteChangeKind)(rng() % 3);
+            change.origin = syntheticCode((int)(rng() % airportCount));
+            change.destination = syntheticCode((int)(rng() % airportCount));
+            if (change.kind != RouteChangeKind::Add) {
+                // Remove or reprice an existing leg so the change has an effect.
+                const RouteGraph& g = currentNetwork()->graph;
+                int u = g.findAirport(change.origin);
+                if (g.degree(u) > 0) change.destination = string(g.code[g.destination[g.offset[u] + (int)(rng() % g.degree(u))]]);
+            }
+            change.distance = (int)(50 + rng() % 2950);
+            change.cost = (int)(30 + rng() % 970);
+            changes.push_back(change);
+        }
+        auto start = chrono::steady_clock::now();
+        applyRouteChanges(changes, skipped); // Legs removed earlier in the same batch are skipped.
+        updateMs.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+
+        shared_ptr<const RouteNetwork> network = currentNetwork();
+        start = chrono::steady_clock::now();
+        MSTResult rebuilt = minimumSpanningForest(buildUndirected(network->graph), MSTEngine::Kruskal);
+        rebuildMs.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+        same = same && rebuilt.totalCost == network->totalCost && rebuilt.edges.size() == network->forest.size();
+        vector<int> inbound(airportCount, 0);
+        for (int v : network->graph.destination) inbound[v]++;
+        same = same && inbound == network->graph.inbound;
+    }
+    done = true;
+    reader.join();
+
+    cout << "airports " << airportCount << ", " << batches << " batches of " << batchSize << " changes" << endl;
+    cout << fixed << setprecision(2);
+    cout << "incremental update  p50 " << percentile(updateMs, 50) << " ms, p99 " << percentile(updateMs, 99) << " ms" << endl;
+    cout << "G_u + MST rebuild   p50 " << percentile(rebuildMs, 50) << " ms, p99 " << percentile(rebuildMs, 99) << " ms" << endl;
+    cout << "reader queries during updates: " << queries << endl;
+    string skippedText = skipped.str();
+    cout << "changes skipped: " << count(skippedText.begin(), skippedText.end(), '\n') << endl;
+    cout << "forest and degrees match rebuild: " << (same ? "yes" : "NO") << endl;
+}
+
+// Function to time Pareto queries between random airport pairs, on a random network (distance and
+// cost unrelated, so frontiers span most of the graph) and a hub-and-spoke one (cost grows with
+// distance). The shortest route on each frontier is checked against Dijkstra, and the cheapest
+// against Dijkstra with distance and cost swapped.
+void benchPareto(int airportCount, int queries, int maxLabels) {
+    for (int kind = 0; kind < 2; kind++) {
+        RouteGraph g = kind == 0 ? makeRandomGraph(airportCount, 4, 21) : makeHubGraph(airportCount, max(2, airportCount / 100), 22);
+        RouteGraph swapped = g;
+        swap(swapped.distance, swapped.cost);
+        ReverseRoutes reversed;
+        reversed.build(g);
+        mt19937_64 rng(8);
+        ParetoScratch scratch;
+        DijkstraScratch dijkstraScratch;
+        vector<double> ms, frontier, labels;
+        int truncated = 0;
+        bool same = true;
+        for (int q = 0; q < queries; q++) {
+            int origin = (int)(rng() % airportCount), target = (int)(rng() % airportCount);
+            auto start = chrono::steady_clock::now();
+            ParetoResult result = paretoRoutes(g, reversed, origin, target, scratch, maxLabels);
+            ms.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+            frontier.push_back((double)result.routes.size());
+            labels.push_back(result.labels);
+            if (result.truncated) {
+                truncated++;
+                continue;
+            }
+            dijkstra(g, origin, target, defaultHeap, dijkstraScratch);
+            if (!dijkstraScratch.reached(target)) {
+                same = same && result.routes.empty();
+                continue;
+            }
+            same = same && !result.routes.empty() && result.routes.front().distance == dijkstraScratch.distance(target)
+                && result.routes.front().cost == dijkstraScratch.cost(target);
+            dijkstra(swapped, origin, target, defaultHeap, dijkstraScratch);
+            same = same && result.routes.back().cost == dijkstraScratch.distance(target)
+                && result.routes.back().distance == dijkstraScratch.cost(target);
+            for (size_t i = 1; i < result.routes.size(); i++) {
+                same = same && result.routes[i].distance > result.routes[i - 1].distance && result.routes[i].cost < result.routes[i - 1].cost;
+            }
+        }
+        cout << (kind == 0 ? "random" : "hub") << ": airports " << airportCount << ", label limit " << maxLabels << ", "
+            << queries << " queries" << endl;
+        cout << fixed << setprecision(2);
+        cout << "  latency     p50 " << percentile(ms, 50) << " ms, p99 " << percentile(ms, 99) << " ms" << endl;
+        cout << "  frontier    p50 " << percentile(frontier, 50) << ", max " << percentile(frontier, 100) << " routes" << endl;
+        cout << "  labels      p50 " << percentile(labels, 50) << ", max " << percentile(labels, 100) << endl;
+        cout << "  truncated   " << truncated << endl;
+        cout << "  frontier ends match Dijkstra: " << (same ? "yes" : "NO") << endl;
+    }
+}
+
+// Function to list every loopless route from origin to target on a small graph, as (weight, airports)
+// under rank with the best leg between each pair, sorted the way kShortestRoutes ranks them.
+void allSimpleRoutes(const RouteGraph& g, int u, int target, RouteRank rank, uint64_t key, vector<int>& path,
+    vector<char>& visited, vector<pair<uint64_t, vector<int>>>& routes) {
+    path.push_back(u);
+    if (u == target) routes.push_back({ key, path });
+    else {
+        visited[u] = 1;
+        for (int e = g.offset[u]; e < g.offset[u + 1]; e++) {
+            int v = g.destination[e];
+            bool firstLeg = true; // Visit each neighbor once, through its best leg.
+            for (int f = g.offset[u]; f < e; f++) firstLeg = firstLeg && g.destination[f] != v;
+            if (!visited[v] && firstLeg) allSimpleRoutes(g, v, target, rank, key + bestLegKey(g, u, v, rank), path, visited, routes);
+        }
+        visited[u] = 0;
+    }
+    path.pop_back();
+}
+
+// Function to check k-shortest routes against exhaustive enumeration on small random graphs, then to
+// time k-shortest queries against a single Dijkstra query on a hub-and-spoke network.
+void benchKShortest(int airportCount, int k, int queries) {
+    int checked = 0, wrong = 0;
+    for (uint64_t seed = 1; seed <= 40; seed++) {
+        RouteGraph small = makeRandomGraph(10, 3, seed);
+        ReverseRoutes reversed;
+        reversed.build(small);
+        KShortestScratch scratch;
+        RouteSet routes;
+        vector<int> path;
+        vector<char> visited(small.airportCount, 0);
+        for (RouteRank rank : { RouteRank::Distance, RouteRank::Cost }) {
+            int origin = (int)(seed % 10), target = (int)((seed * 7 + 3) % 10);
+            if (origin == target) continue;
+            vector<pair<uint64_t, vector<int>>> all;
+            allSimpleRoutes(small, origin, target, rank, 0, path, visited, all);
+            sort(all.begin(), all.end());
+            kShortestRoutes(small, reversed, origin, target, k, rank, scratch, routes);
+            bool same = routes.size() == min(k, (int)all.size());
+            for (int i = 0; same && i < routes.size(); i++) {
+                same = vector<int>(routes.path(i), routes.path(i) + routes.pathLength(i)) == all[i].second;
+            }
+            checked++;
+            wrong += !same;
+        }
+    }
+
+    RouteGraph g = makeHubGraph(airportCount, max(2, airportCount / 100), 51);
+    ReverseRoutes reversed;
+    reversed.build(g); // Once per graph, like the network versions and the task graph.
+    mt19937_64 rng(5);
+    DijkstraScratch dijkstraScratch;
+    KShortestScratch scratch;
+    RouteSet routes;
+    vector<double> singleMs, kMs, found;
+    for (int q = 0; q < queries; q++) {
+        int origin = (int)(rng() % airportCount), target = (int)(rng() % airportCount);
+        auto start = chrono::steady_clock::now();
+        dijkstra(g, origin, target, defaultHeap, dijkstraScratch);
+        auto middle = chrono::steady_clock::now();
+        kShortestRoutes(g, reversed, origin, target, k, RouteRank::Distance, scratch, routes);
+        auto stop = chrono::steady_clock::now();
+        singleMs.push_back(chrono::duration<double, milli>(middle - start).count());
+        kMs.push_back(chrono::duration<double, milli>(stop - middle).count());
+        found.push_back(routes.size());
+    }
+    cout << "exhaustive check: " << checked << " small queries, " << wrong << " mismatches" << endl;
+    cout << "airports " << airportCount << ", legs " << g.edgeCount() << ", k " << k << ", " << queries << " queries" << endl;
+    cout << fixed << setprecision(2);
+    cout << "dijkstra     p50 " << percentile(singleMs, 50) << " ms, p99 " << percentile(singleMs, 99) << " ms" << endl;
+    cout << "k-shortest   p50 " << percentile(kMs, 50) << " ms, p99 " << percentile(kMs, 99) << " ms" << endl;
+    cout << "routes found p50 " << percentile(found, 50) << ", min " << percentile(found, 0) << endl;
+}
+
+// Function to make a random daily schedule for a route graph: flightsPerLeg flights on every leg,
+// departing between 05:00 and 23:00, flying 30 minutes plus a minute per 8 distance units; every
+// airport gets a minimum connection time of 20 to 60 minutes.
+Timetable makeTimetable(const RouteGraph& g, int flightsPerLeg, uint64_t seed) {
+    mt19937_64 rng(seed);
+    vector<ScheduledFlight> flights;
+    flights.reserve((size_t)g.edgeCount() * flightsPerLeg);
+    for (int u = 0; u < g.airportCount; u++) {
+        for (int e = g.offset[u]; e < g.offset[u + 1]; e++) {
+            for (int f = 0; f < flightsPerLeg; f++) {
+                int departure = 300 + (int)(rng() % 1080);
+                flights.push_back({ departure, departure + 30 + g.distance[e] / 8, u, g.destination[e], g.cost[e] });
+            }
+        }
+    }
+    vector<int> minConnection(g.airportCount);
+    for (int& m : minConnection) m = 20 + (int)(rng() % 41);
+    Timetable timetable;
+    buildTimetable(flights, minConnection, timetable);
+    return timetable;
+}
+
+// Function to answer an earliest-arrival query by time-dependent Dijkstra over each airport's
+// departures, as an independent check of the connection scan. Returns the arrival, or INF.
+int earliestArrivalDijkstra(const Timetable& tt, const vector<int>& byOrigin, const vector<int>& originStart,
+    int origin, int target, int departAfter) {
+    vector<int> best(tt.airportCount, INF);
+    vector<pair<int, int>> heap = { { departAfter, origin } };
+    best[origin] = departAfter;
+    while (!heap.empty()) {
+        pop_heap(heap.begin(), heap.end(), greater<pair<int, int>>());
+        auto [t, u] = heap.back();
+        heap.pop_back();
+        if (t != best[u]) continue;
+        if (u == target) return t;
+        int ready = u == origin ? t : t + tt.minConnection[u];
+        for (int k = originStart[u]; k < originStart[u + 1]; k++) {
+            int c = byOrigin[k];
+            if (tt.departure[c] < ready || tt.arrival[c] >= best[tt.to[c]]) continue;
+            best[tt.to[c]] = tt.arrival[c];
+            heap.push_back({ tt.arrival[c], tt.to[c] });
+            push_heap(heap.begin(), heap.end(), greater<pair<int, int>>());
+        }
+    }
+    return INF;
+}
+
+// Function to time earliest-arrival queries on a synthetic schedule, after a round trip through the
+// schedule CSV, and to check every answer against time-dependent Dijkstra.
+void benchTimetable(int airportCount, int flightsPerLeg, int queries) {
+    RouteGraph generated = makeHubGraph(airportCount, max(2, airportCount / 100), 61);
+    Timetable written = makeTimetable(generated, flightsPerLeg, 62);
+    const string filename = "bench_schedule.csv";
+    if (!writeScheduleCSV(generated, written, filename)) {
+        cerr << "Cannot write " << filename << endl;
+        return;
+    }
+    MappedFile file;
+    RouteGraph g;
+    Timetable tt;
+    file.open(filename);
+    auto start = chrono::steady_clock::now();
+    loadSchedule(file, filename, g, tt);
+    double loadSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    file.close();
+    remove(filename.c_str());
+
+    // Departures grouped by origin airport, for the reference search.
+    vector<int> originStart(tt.airportCount + 1, 0), byOrigin(tt.flightCount());
+    for (int c = 0; c < tt.flightCount(); c++) originStart[tt.from[c] + 1]++;
+    for (int i = 0; i < tt.airportCount; i++) originStart[i + 1] += originStart[i];
+    vector<int> fill(originStart.begin(), originStart.end() - 1);
+    for (int c = 0; c < tt.flightCount(); c++) byOrigin[fill[tt.from[c]]++] = c;
+
+    mt19937_64 rng(63);
+    TimetableScratch scratch;
+    vector<int> flights;
+    vector<double> ms;
+    int found = 0, mismatches = 0;
+    for (int q = 0; q < queries; q++) {
+        int origin = (int)(rng() % tt.airportCount), target = (int)(rng() % tt.airportCount);
+        int departAfter = 300 + (int)(rng() % 600);
+        start = chrono::steady_clock::now();
+        JourneyResult journey = earliestArrival(tt, origin, target, departAfter, scratch, flights);
+        ms.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+        found += journey.found;
+        int expected = earliestArrivalDijkstra(tt, byOrigin, originStart, origin, target, departAfter);
+        bool same = journey.found ? journey.arrival == expected : expected == INF;
+        // The flights must chain: each departs from where the last landed, after the connection time.
+        int at = origin, ready = departAfter;
+        for (int c : flights) {
+            same = same && tt.from[c] == at && tt.departure[c] >= ready;
+            at = tt.to[c];
+            ready = tt.arrival[c] + tt.minConnection[at];
+        }
+        mismatches += !(same && (!journey.found || at == target));
+    }
+    cout << "airports " << tt.airportCount << ", flights " << tt.flightCount() << ", loaded in " << fixed
+        << setprecision(2) << loadSeconds << " s" << endl;
+    cout << "connection scan p50 " << setprecision(3) << percentile(ms, 50) << " ms, p99 " << percentile(ms, 99)
+        << " ms, max " << percentile(ms, 100) << " ms" << endl;
+    cout << queries << " queries, " << found << " with a journey, " << mismatches << " mismatches with time-dependent Dijkstra" << endl;
+}
+
+// Function to check that a path is a real route with the given packed length (using the best leg
+// between each consecutive pair of airports).
+bool routeMatchesKey(const RouteGraph& g, const vector<int>& path, uint64_t key) {
+    uint64_t total = 0;
+    for (size_t i = 0; i + 1 < path.size(); i++) {
+        uint64_t leg = INF_KEY;
+        for (int e = g.offset[path[i]]; e < g.offset[path[i] + 1]; e++) {
+            if (g.destination[e] == path[i + 1]) leg = min(leg, routeKey(g.distance[e], g.cost[e]));
+        }
+        if (leg == INF_KEY) return false;
+        total += leg;
+    }
+    return total == key;
+}
+
+// Function to build contraction hierarchies of hub-and-spoke networks, check hierarchy routes against
+// Dijkstra on random pairs, round-trip the hierarchy file, and compare query latency.
+void benchHierarchy(const vector<int>& sizes, int queries) {
+    for (int n : sizes) {
+        RouteGraph g = makeHubGraph(n, max(2, n / 100), 31);
+        auto start = chrono::steady_clock::now();
+        ContractionHierarchy ch = buildHierarchy(g);
+        double buildSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        const string filename = "bench-hierarchy.ch";
+        ContractionHierarchy loaded;
+        bool fileOk = writeHierarchy(ch, filename) && loadHierarchy(filename, g, loaded) && loaded.upWeight == ch.upWeight
+            && loaded.downWeight == ch.downWeight && loaded.upMiddle == ch.upMiddle;
+        remove(filename.c_str());
+
+        mt19937_64 rng(12);
+        DijkstraScratch dijkstraScratch;
+        HierarchyScratch hierarchyScratch;
+        vector<int> path;
+        vector<double> dijkstraUs, hierarchyUs;
+        int mismatches = 0;
+        for (int q = 0; q < queries; q++) {
+            int origin = (int)(rng() % n), target = (int)(rng() % n);
+            start = chrono::steady_clock::now();
+            dijkstra(g, origin, target, defaultHeap, dijkstraScratch);
+            dijkstraUs.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+            start = chrono::steady_clock::now();
+            RouteResult route = hierarchyRoute(loaded, origin, target, hierarchyScratch, path);
+            hierarchyUs.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+            bool same = route.found == dijkstraScratch.reached(target);
+            if (same && route.found) {
+                same = route.distance == dijkstraScratch.distance(target) && route.cost == dijkstraScratch.cost(target)
+                    && path.front() == origin && path.back() == target
+                    && routeMatchesKey(g, path, routeKey(route.distance, route.cost));
+            }
+            mismatches += !same;
+        }
+        cout << "airports " << n << ", legs " << g.edgeCount() << ": built in " << fixed << setprecision(2) << buildSeconds
+            << " s, " << ch.shortcutCount() << " shortcuts, core " << ch.coreSize << ", file " << (fileOk ? "ok" : "FAILED") << endl;
+        cout << "  dijkstra   p50 " << percentile(dijkstraUs, 50) << " us, p99 " << percentile(dijkstraUs, 99) << " us" << endl;
+        cout << "  hierarchy  p50 " << percentile(hierarchyUs, 50) << " us, p99 " << percentile(hierarchyUs, 99) << " us" << endl;
+        cout << "  " << queries << " random pairs, " << mismatches << " mismatches" << endl;
+    }
+}
+
+// Function to check the connectivity index against searches on small random graphs (every pair, with
+// and without the closure), then to time it on sparse networks with many components: a directed
+// random graph with 0 to 3 legs per airport, and a geometric network with a low mean degree.
+void benchConnectivity(int airportCount, int queries) {
+    int pairs = 0, wrong = 0;
+    for (uint64_t seed = 1; seed <= 40; seed++) {
+        mt19937_64 rng(seed);
+        RouteGraphBuilder builder;
+        for (int i = 0; i < 30; i++) builder.getAirportIndex(syntheticCode(i));
+        for (int u = 0; u < 30; u++) {
+            for (int k = (int)(rng() % 3); k > 0; k--) builder.legs.push_back({ u, (int)(rng() % 30), 100, 100 });
+        }
+        RouteGraph small = builder.finalize();
+        ConnectivityIndex exact, bounded;
+        exact.build(small);
+        bounded.build(small, 0);
+        DijkstraScratch scratch;
+        for (int u = 0; u < small.airportCount; u++) {
+            dijkstra(small, u, -1, defaultHeap, scratch);
+            for (int v = 0; v < small.airportCount; v++) {
+                Reachability truth = scratch.reached(v) ? Reachability::Yes : Reachability::No;
+                Reachability quick = bounded.reachable(u, v);
+                wrong += exact.reachable(u, v) != truth || (quick != Reachability::Unknown && quick != truth);
+                pairs++;
+            }
+        }
+    }
+    cout << "checked " << pairs << " pairs on small random graphs: " << wrong << " wrong" << endl;
+
+    for (int kind = 0; kind < 2; kind++) {
+        RouteGraph g;
+        if (kind == 0) {
+            mt19937_64 rng(51);
+            RouteGraphBuilder builder;
+            for (int i = 0; i < airportCount; i++) builder.getAirportIndex(syntheticCode(i));
+            for (int u = 0; u < airportCount; u++) {
+                for (int k = (int)(rng() % 4); k > 0; k--) {
+                    builder.legs.push_back({ u, (int)(rng() % airportCount), (int)(50 + rng() % 2950), (int)(30 + rng() % 970) });
+                }
+            }
+            g = builder.finalize();
+        }
+        else {
+            g = makeGeometricGraph(airportCount, 2.5, 52);
+        }
+        auto start = chrono::steady_clock::now();
+        ConnectivityIndex index;
+        index.build(g);
+        double buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        int largest = 0, largestWeak = 0;
+        for (int c = 0; c < index.sccCount; c++) largest = max(largest, index.sccSize(c));
+        for (int c = 0; c < index.weakCount; c++) largestWeak = max(largestWeak, index.weakSize(c));
+
+        mt19937_64 rng(53);
+        DijkstraScratch scratch;
+        int answered[3] = {}, mismatches = 0;
+        double searchMs = 0, checkMs = 0; // Time spent on unreachable pairs by searching and by the index.
+        for (int q = 0; q < queries; q++) {
+            int origin = (int)(rng() % airportCount), target = (int)(rng() % airportCount);
+            start = chrono::steady_clock::now();
+            Reachability quick = index.reachable(origin, target);
+            double indexMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            start = chrono::steady_clock::now();
+            dijkstra(g, origin, target, defaultHeap, scratch);
+            double dijkstraMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            bool reached = scratch.reached(target);
+            answered[(int)quick]++;
+            mismatches += (quick == Reachability::No && reached) || (quick == Reachability::Yes && !reached);
+            if (!reached) {
+                searchMs += dijkstraMs;
+                checkMs += indexMs;
+            }
+        }
+        cout << (kind == 0 ? "directed" : "geometric") << ": airports " << airportCount << ", legs " << g.edgeCount()
+            << ", built in " << fixed << setprecision(2) << buildMs << " ms" << endl;
+        cout << "  strong components " << index.sccCount << " (largest " << largest << "), weak components "
+            << index.weakCount << " (largest " << largestWeak << "), closure " << (index.closureWords ? "yes" : "no") << endl;
+        cout << "  " << queries << " random pairs: " << answered[(int)Reachability::No] << " rejected, "
+            << answered[(int)Reachability::Yes] << " reachable, " << answered[(int)Reachability::Unknown] << " unknown, "
+            << mismatches << " mismatches" << endl;
+        cout << "  unreachable pairs: " << searchMs << " ms searching, " << checkMs << " ms with the index" << endl;
+    }
+}
+
+// Counter of the hardware cache misses of the calling thread (Linux perf events, user space only).
+// Unavailable elsewhere, or where the kernel does not allow it; the benchmarks then print "n/a".
+struct CacheMissCounter {
+    int fd = -1; // perf event descriptor, or -1.
+
+    CacheMissCounter() {
+#ifdef __linux__
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+    ~CacheMissCounter() {
+#ifdef __linux__
+        if (fd != -1) close(fd);
+#endif
+    }
+    CacheMissCounter(const CacheMissCounter&) = delete;
+    CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+    bool available() const { return fd != -1; }
+
+    // Function to reset and start counting.
+    void start() {
+#ifdef __linux__
+        if (fd == -1) return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    // Function to stop counting and return the misses since start(), or -1 if unavailable.
+    long long stop() {
+#ifdef __linux__
+        uint64_t count = 0;
+        if (fd == -1) return -1;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &count, sizeof(count)) == (ssize_t)sizeof(count)) return (long long)count;
+#endif
+        return -1;
+    }
+};
+
+// Function to compare airport orders on a geometric and a hub-and-spoke network (both generated with
+// airports in random order). For every order it reports the locality of the legs (mean index gap, and
+// the share of legs whose endpoints share a 16-airport block, one cache line of an int array), the
+// latency and cache misses of the same point-to-point queries, and whether the answers match.
+void benchOrder(int airportCount, int queries) {
+    CacheMissCounter misses;
+    if (!misses.available()) cout << "cache-miss counter unavailable; reporting locality and latency only" << endl;
+    for (int kind = 0; kind < 2; kind++) {
+        RouteGraph g = kind == 0 ? makeGeometricGraph(airportCount, 6, 61) : makeHubGraph(airportCount, max(2, airportCount / 100), 62);
+        mt19937_64 rng(63);
+        vector<pair<int, int>> pairs(queries); // Origin and target, as loaded.
+        for (auto& [origin, target] : pairs) {
+            origin = (int)(rng() % airportCount);
+            target = (int)(rng() % airportCount);
+        }
+        cout << (kind == 0 ? "geometric" : "hub") << ": airports " << g.airportCount << ", legs " << g.edgeCount() << endl;
+        cout << left << setw(9) << "order" << setw(12) << "renumber ms" << setw(10) << "mean gap" << setw(14) << "same block %"
+            << setw(10) << "p50 ms" << setw(10) << "p99 ms" << setw(16) << "misses/query" << "answers" << right << endl;
+        vector<long long> reference; // Packed (distance, cost) of every query in loaded order.
+        DijkstraScratch scratch;
+        for (int o = 0; o < 4; o++) {
+            AirportOrder order = (AirportOrder)o;
+            auto start = chrono::steady_clock::now();
+            vector<int> ordering = airportOrdering(g, order);
+            RouteGraph r = renumberAirports(g, ordering);
+            double renumberMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            vector<int> position(airportCount);
+            for (int i = 0; i < airportCount; i++) position[ordering[i]] = i;
+
+            double gap = 0;
+            long long sameBlock = 0;
+            for (int u = 0; u < r.airportCount; u++) {
+                for (int e = r.offset[u]; e < r.offset[u + 1]; e++) {
+                    gap += abs(u - r.destination[e]);
+                    sameBlock += u / 16 == r.destination[e] / 16;
+                }
+            }
+
+            vector<double> ms;
+            vector<long long> answers;
+            misses.start();
+            for (const auto& [origin, target] : pairs) {
+                start = chrono::steady_clock::now();
+                dijkstra(r, position[origin], position[target], defaultHeap, scratch);
+                ms.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+                int t = position[target];
+                answers.push_back(scratch.reached(t) ? (long long)scratch.distance(t) << 32 | scratch.cost(t) : -1);
+            }
+            long long missCount = misses.stop();
+            if (order == AirportOrder::Loaded) reference = answers;
+
+            ostringstream perQuery;
+            if (missCount < 0) perQuery << "n/a";
+            else perQuery << missCount / max(1, queries);
+            cout << left << setw(9) << AIRPORT_ORDER_NAME[o] << fixed << setprecision(2) << setw(12) << renumberMs
+                << setw(10) << setprecision(0) << gap / max(1, r.edgeCount())
+                << setw(14) << setprecision(1) << 100.0 * sameBlock / max(1, r.edgeCount()) << setprecision(3)
+                << setw(10) << percentile(ms, 50) << setw(10) << percentile(ms, 99) << setw(16) << perQuery.str()
+                << (answers == reference ? "same" : "DIFFERENT") << right << endl;
+        }
+    }
+}
+
+// Function to measure query server throughput for growing thread counts on a random network, with a
+// fixed mix of path, stops, state, top and mst requests. Every run must give the same responses.
+void benchServer(int airportCount, int requests, int maxThreads) {
+    RouteGraph g = makeHubGraph(airportCount, max(2, airportCount / 100), 41);
+    publishNetwork(g);
+    mt19937_64 rng(9);
+    string input;
+    for (int i = 0; i < requests; i++) {
+        string a = syntheticCode((int)(rng() % airportCount)), b = syntheticCode((int)(rng() % airportCount));
+        switch (i % 10) {
+        case 0: input += "stops " + a + " " + b + " 2\n"; break;
+        case 1: input += "top 10\n"; break;
+        case 2: input += "mst\n"; break;
+        default: input += "path " + a + " " + b + "\n"; break;
+        }
+    }
+    cout << "airports " << airportCount << ", " << requests << " requests (70% path, 10% stops, 10% top, 10% mst)" << endl;
+    cout << left << setw(10) << "threads" << setw(12) << "seconds" << setw(16) << "queries_per_s" << setw(10) << "same" << endl;
+    string reference;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        ThreadPool pool(threads);
+        vector<QueryWorker> workers(threads);
+        istringstream in(input);
+        ostringstream out;
+        auto start = chrono::steady_clock::now();
+        serveStream(in, out, pool, workers);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (reference.empty()) reference = out.str();
+        cout << left << setw(10) << threads << setw(12) << fixed << setprecision(3) << seconds << setw(16)
+            << setprecision(0) << requests / seconds << setw(10) << (out.str() == reference ? "yes" : "NO") << endl;
+    }
+}
+
+// Function to build the synthetic network named by generator ("hub" or "geometric"), or an empty
+// graph for an unknown name. Hub networks get one hub per 100 airports; geometric ones about
+// 8 neighbors per airport.
+RouteGraph makeSyntheticGraph(const string& generator, int airportCount, uint64_t seed) {
+    if (generator == "hub") return makeHubGraph(airportCount, max(2, airportCount / 100), seed);
+    if (generator == "geometric") return makeGeometricGraph(airportCount, 8, seed);
+    return RouteGraph();
+}
+
+// Timing samples of one task on one synthetic network.
+struct BenchRecord {
+    string generator;       // "hub" or "geometric".
+    int airports;           // Airports generated (isolated ones are lost in the CSV round trip).
+    int legs;               // Legs in the network.
+    string task;            // Task that was timed.
+    vector<double> samples; // One duration per run, in microseconds.
+};
+
+// Function to write benchmark records as JSON: one object per (network, task) with the sample
+// count and the mean, p50, p90, p99 and max durations in microseconds.
+void writeBenchJson(ostream& out, const vector<BenchRecord>& records) {
+    out << "{\n  \"unit\": \"us\",\n  \"results\": [";
+    for (size_t i = 0; i < records.size(); i++) {
+        const BenchRecord& r = records[i];
+        double mean = 0;
+        for (double t : r.samples) mean += t;
+        if (!r.samples.empty()) mean /= r.samples.size();
+        out << (i ? "," : "") << "\n    { \"generator\": \"" << r.generator << "\", \"airports\": " << r.airports
+            << ", \"legs\": " << r.legs << ", \"task\": \"" << r.task << "\", \"runs\": " << r.samples.size()
+            << fixed << setprecision(1) << ", \"mean\": " << mean << ", \"p50\": " << percentile(r.samples, 50)
+            << ", \"p90\": " << percentile(r.samples, 90) << ", \"p99\": " << percentile(r.samples, 99)
+            << ", \"max\": " << percentile(r.samples, 100) << " }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+// Function to time every task on hub-and-spoke and random geometric networks of each size. Each
+// network is written to a CSV and loaded back the way readCSV loads it (parse, then index the
+// states); the tasks are then timed through the result-returning engines they print from, so the
+// numbers leave out formatting. Progress goes to cerr and the results to json.
+void benchSuite(const vector<int>& sizes, ostream& json) {
+    vector<BenchRecord> records;
+    const string filename = "bench_suite_network.csv";
+    for (const char* generator : { "hub", "geometric" }) {
+        for (int n : sizes) {
+            RouteGraph generated = makeSyntheticGraph(generator, n, 20240 + n);
+            if (!writeRouteCSV(generated, filename)) {
+                cerr << "Cannot write " << filename << endl;
+                return;
+            }
+            bool large = n > 100000;
+            BenchRecord base{ generator, 0, 0, "", {} };
+            // Times run(i) for i = 0 .. runs - 1 and records the durations under task.
+            auto time = [&](const char* task, int runs, auto&& run) {
+                BenchRecord record = base;
+                record.task = task;
+                for (int i = 0; i < runs; i++) {
+                    auto start = chrono::steady_clock::now();
+                    run(i);
+                    record.samples.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+                }
+                records.push_back(move(record));
+            };
+
+            RouteGraph g;
+            RegionIndex regions;
+            MappedFile file;
+            file.open(filename);
+            base.airports = n;
+            base.legs = generated.edgeCount();
+            time("load", large ? 2 : 5, [&](int) {
+                loadRouteFile(file, filename, g);
+                regions.build(g);
+            });
+            file.close();
+            remove(filename.c_str());
+            cerr << generator << " " << n << ": " << g.airportCount << " airports, " << g.edgeCount() << " legs" << endl;
+
+            mt19937_64 rng(n);
+            vector<pair<int, int>> pairs(200);
+            for (auto& q : pairs) q = { (int)(rng() % g.airportCount), (int)(rng() % g.airportCount) };
+            DijkstraScratch dijkstraScratch;
+            vector<int> path;
+            time("findShortestPath", (int)pairs.size(), [&](int i) {
+                shortestRoute(g, pairs[i].first, pairs[i].second, defaultHeap, dijkstraScratch, path);
+            });
+            RouteSet routes;
+            time("usingState", 50, [&](int i) {
+                const vector<int>& airports = regions.stateAirports[pairs[i].second % regions.stateAirports.size()];
+                shortestRoutesToMany(g, pairs[i].first, airports, defaultHeap, dijkstraScratch, routes);
+            });
+            StopsScratch stopsScratch;
+            time("withNoOfStops", large ? 10 : 50, [&](int i) {
+                shortestWithStops(g, pairs[i].first, pairs[i].second, 2, StopsMode::Exact, true, stopsScratch, path);
+            });
+            vector<AirportConnection> top;
+            time("FlightConnections", 5, [&](int) { topConnectedAirports(g, g.airportCount, DegreeKind::Total, top); });
+            UndirectedGraph gu;
+            time("buildUndirectedGraph", large ? 2 : 5, [&](int) { gu = buildUndirected(g); });
+            time("primMST", large ? 2 : 5, [&](int) { minimumSpanningForest(gu, MSTEngine::EagerPrim); });
+            time("kruskalMST", large ? 2 : 5, [&](int) { minimumSpanningForest(gu, MSTEngine::Kruskal); });
+        }
+    }
+    writeBenchJson(json, records);
+}
+
+int main(int argc, char* argv[]) {
+    // Options in front of the other arguments: "--order loaded|bfs|rcm|hub" renumbers the airports
+    // after loading, "--threads N" sets the threads used to load route CSVs (1 loads sequentially),
+    // and "--hierarchy FILE" answers shortest-path queries of the demo and the server from a
+    // hierarchy written by --build-hierarchy (with the same --order), falling back to Dijkstra
+    // if it does not load.
+    string hierarchyFile;
+    while (argc > 2) {
+        string option = argv[1];
+        if (option == "--order") {
+            if (!parseAirportOrder(argv[2], airportOrder)) {
+                cerr << "Unknown airport order " << argv[2] << " (loaded, bfs, rcm or hub)" << endl;
+                return 1;
+            }
+        }
+        else if (option == "--threads") {
+            if (!parseInt(argv[2], loaderThreads) || loaderThreads < 1) {
+                cerr << "Bad thread count " << argv[2] << endl;
+                return 1;
+            }
+        }
+        else if (option == "--hierarchy") {
+            hierarchyFile = argv[2];
+        }
+        else {
+            break;
+        }
+        argc -= 2;
+        argv += 2;
+    }
+    // Command-line switches select a benchmark instead of the task demo.
+    if (argc > 1 && string(argv[1]) == "--bench-dijkstra") {
+        vector<int> sizes = { 10000, 100000, 1000000 }; // Graph sizes; override with further arguments.
+        if (argc > 2) sizes.clear();
+        for (int i = 2; i < argc; i++) sizes.push_back(stoi(argv[i]));
+        benchDijkstra(sizes, 100);
+        return 0;
+    }
+    if (argc > 2 && string(argv[1]) == "--bench-load") {
+        benchLoad(argv[2], argc > 3 ? stoi(argv[3]) : (int)max(1u, thread::hardware_concurrency()));
+        return 0;
+    }
+    if (argc > 3 && string(argv[1]) == "--convert") {
+        // Convert a route CSV to a binary snapshot.
+        MappedFile file;
+        RouteGraph graph;
+        if (!file.open(argv[2])) {
+            cerr << "Cannot open " << argv[2] << endl;
+            return 1;
+        }
+        loadRouteFile(file, argv[2], graph);
+        if (!writeSnapshot(graph, argv[3])) {
+            cerr << "Cannot write " << argv[3] << endl;
+            return 1;
+        }
+        cout << "Wrote " << graph.airportCount << " airports and " << graph.edgeCount() << " legs to " << argv[3] << endl;
+        return 0;
+    }
+    if (argc > 3 && string(argv[1]) == "--verify-snapshot") {
+        return verifySnapshot(argv[2], argv[3], 1000) ? 0 : 1;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-batch") {
+        int maxThreads = argc > 2 ? stoi(argv[2]) : (int)max(1u, thread::hardware_concurrency());
+        benchBatch(20000, 400, maxThreads);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-stops") {
+        int maxStops = argc > 2 ? stoi(argv[2]) : 3; // DFS cost grows as degree^(stops + 1).
+        benchStops(2000, 40, maxStops, 20);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-updates") {
+        benchUpdates(argc > 2 ? stoi(argv[2]) : 100000, argc > 3 ? stoi(argv[3]) : 50, argc > 4 ? stoi(argv[4]) : 100);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-pareto") {
+        benchPareto(argc > 2 ? stoi(argv[2]) : 100000, 100, argc > 3 ? stoi(argv[3]) : 1 << 20);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-kshortest") {
+        benchKShortest(argc > 2 ? stoi(argv[2]) : 100000, argc > 3 ? stoi(argv[3]) : 10, 100);
+        return 0;
+    }
+    if (argc > 5 && string(argv[1]) == "--schedule") {
+        // Earliest arrival on a schedule CSV: --schedule file ORIGIN DEST HH:MM
+        MappedFile file;
+        RouteGraph graph;
+        Timetable timetable;
+        if (!file.open(argv[2])) {
+            cerr << "Cannot open " << argv[2] << endl;
+            return 1;
+        }
+        loadSchedule(file, argv[2], graph, timetable);
+        findEarliestArrival(graph, timetable, argv[3], argv[4], argv[5]);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-timetable") {
+        benchTimetable(argc > 2 ? stoi(argv[2]) : 20000, argc > 3 ? stoi(argv[3]) : 4, 1000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-order") {
+        benchOrder(argc > 2 ? stoi(argv[2]) : 200000, 200);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-connectivity") {
+        benchConnectivity(argc > 2 ? stoi(argv[2]) : 100000, 1000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-hierarchy") {
+        vector<int> sizes = { 10000, 100000 }; // Graph sizes; override with further arguments.
+        if (argc > 2) sizes.clear();
+        for (int i = 2; i < argc; i++) sizes.push_back(stoi(argv[i]));
+        benchHierarchy(sizes, 1000);
+        return 0;
+    }
+    if (argc > 3 && string(argv[1]) == "--build-hierarchy") {
+        // Build the contraction hierarchy of a route CSV and store it beside the graph.
+        MappedFile file;
+        RouteGraph graph;
+        if (!file.open(argv[2])) {
+            cerr << "Cannot open " << argv[2] << endl;
+            return 1;
+        }
+        loadRouteFile(file, argv[2], graph);
+        if (airportOrder != AirportOrder::Loaded) graph = renumberAirports(graph, airportOrdering(graph, airportOrder));
+        ContractionHierarchy ch = buildHierarchy(graph);
+        if (!writeHierarchy(ch, argv[3])) {
+            cerr << "Cannot write " << argv[3] << endl;
+            return 1;
+        }
+        cout << "Wrote " << ch.shortcutCount() << " shortcuts (core " << ch.coreSize << ") to " << argv[3] << endl;
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-server") {
+        benchServer(20000, 10000, argc > 2 ? stoi(argv[2]) : (int)max(1u, thread::hardware_concurrency()));
+        return 0;
+    }
+    if (argc > 1 && (string(argv[1]) == "--serve" || string(argv[1]) == "--serve-socket")) {
+        // Query server over airports.txt (plus regions.txt): stdin/stdout, or a Unix socket path.
+        readCSV("airports.txt");
+        regionIndex.loadRegions("regions.txt", routeGraph);
+        shared_ptr<ContractionHierarchy> hierarchy;
+        if (!hierarchyFile.empty()) {
+            hierarchy = make_shared<ContractionHierarchy>();
+            if (!loadHierarchy(hierarchyFile, routeGraph, *hierarchy)) hierarchy = nullptr; // Serve with Dijkstra.
+        }
+        publishNetwork(routeGraph, &regionIndex, hierarchy);
+        ThreadPool pool((int)max(1u, thread::hardware_concurrency()));
+        vector<QueryWorker> workers(pool.size());
+        if (string(argv[1]) == "--serve") {
+            ios::sync_with_stdio(false); // Lets the server see how much input is already buffered.
+            serveStream(cin, cout, pool, workers);
+            return 0;
+        }
+#ifndef _WIN32
+        if (argc > 2 && serveSocket(argv[2], pool, workers)) return 0;
+#endif
+        cerr << "Cannot serve on socket " << (argc > 2 ? argv[2] : "(missing path)") << endl;
+        return 1;
+    }
+    if (argc > 5 && string(argv[1]) == "--generate") {
+        // Write a synthetic network as a route CSV: --generate hub|geometric airports seed out.csv
+        RouteGraph graph = makeSyntheticGraph(argv[2], stoi(argv[3]), stoull(argv[4]));
+        if (graph.airportCount == 0 || !writeRouteCSV(graph, argv[5])) {
+            cerr << "Cannot generate " << argv[2] << " network into " << argv[5] << endl;
+            return 1;
+        }
+        cout << "Wrote " << graph.airportCount << " airports and " << graph.edgeCount() << " legs to " << argv[5] << endl;
+        return 0;
+    }
+    if (argc > 2 && string(argv[1]) == "--bench-suite") {
+        // Time every task on synthetic networks: --bench-suite out.json [sizes] ("-" writes to stdout).
+        vector<int> sizes = { 1000, 10000, 100000, 1000000 };
+        if (argc > 3) sizes.clear();
+        for (int i = 3; i < argc; i++) sizes.push_back(stoi(argv[i]));
+        if (string(argv[2]) == "-") {
+            benchSuite(sizes, cout);
+            return 0;
+        }
+        ofstream json(argv[2]);
+        if (!json) {
+            cerr << "Cannot write " << argv[2] << endl;
+            return 1;
+        }
+        benchSuite(sizes, json);
+#ifdef ROUTE_STATS
+        writeRouteStats(cerr);
+#endif
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-mst") {
+        vector<int> sizes = { 10000, 100000, 1000000 }; // Graph sizes; override with further arguments.
+        if (argc > 2) sizes.clear();
+        for (int i = 2; i < argc; i++) sizes.push_back(stoi(argv[i]));
+        benchMST(sizes, (int)max(1u, thread::hardware_concurrency()));
+        return 0;
+    }
+
+    // EDIT FILE PATH FOR NEW COMPUTER
+    //Here is template
+
+    //readCSV("C:FILEPATH put the file path here to use .csv file\\airports.csv");
+    // "--snapshot file" starts from a binary snapshot (see --convert) instead of the CSV.
+    if (argc > 2 && string(argv[1]) == "--snapshot") {
+        if (!readSnapshot(argv[2])) return 1;
+    }
+    else {
+        readCSV("airports.txt");
+    }
+    if (!hierarchyFile.empty()) loadHierarchy(hierarchyFile, routeGraph, routeHierarchy); // Dijkstra if it fails.
     // Task 2 test
     //Change "ABE" and "DTW" to your desired airports for different results.
     cout << "Task 2" << endl;
@@ -587,12 +6035,16 @@ int main() {
     findShortestPath("ABQ", "IAH");
     findShortestPath("ABE", "MIA");
     findShortestPath("ABE", "EYW");
+    findRouteTradeoffs("ABE", "MIA");
+    findAlternativeRoutes("ABE", "MIA", 3);
 
     cout << "\n";
 
     //Task 3 test
     cout << "Task 3" << endl;
     usingState("ABE", "Miami, FL");
+    regionIndex.loadRegions("regions.txt", routeGraph); // Optional named regions.
+    usingRegion("ABE", "Texas hubs");
 
     cout << "\n";
 
@@ -622,5 +6074,9 @@ int main() {
     cout << "Task 8" << endl;
     kruskalMST();
 
+#ifdef ROUTE_STATS
+    cerr << "\nQuery statistics\n";
+    writeRouteStats(cerr);
+#endif
     return 0;
 }